@@ -0,0 +1,201 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <array>
+#include <stdexcept>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "bitboard.hpp"
+#include "piece.hpp"
+#include "square.hpp"
+
+using namespace std;
+
+/**
+ * @brief Attack lookups. Each square owns a slice of a shared slider attack table, indexed by the relevant
+ * blockers of the occupancy. On BMI2 hosts the index is computed with PEXT, otherwise with a magic multiply.
+ * Leaper attacks and the between/line rays used for check and pin masks are built at compile time.
+ */
+namespace Attacks {
+
+constexpr int ROOK_TABLE_SIZE = 0x19000;  // Sum of 2^(relevant bits) over all squares
+constexpr int BISHOP_TABLE_SIZE = 0x1480;
+
+// Found with a sparse xorshift64* search, fixed so startup only has to fill the tables
+constexpr uint64_t ROOK_MAGICS[NUM_SQUARES] = {
+    0xa80004000801220ULL, 0x8040004010002008ULL, 0x2080200010008008ULL, 0x1100100008210004ULL,
+    0xc200209084020008ULL, 0x2100010004000208ULL, 0x400081000822421ULL, 0x200010422048844ULL,
+    0x800800080400024ULL, 0x1402000401000ULL, 0x3000801000802001ULL, 0x4400800800100083ULL,
+    0x904802402480080ULL, 0x4040800400020080ULL, 0x18808042000100ULL, 0x4040800080004100ULL,
+    0x40048001458024ULL, 0xa0004000205000ULL, 0x3100808010002000ULL, 0x4825010010000820ULL,
+    0x5004808008000401ULL, 0x2024818004000a00ULL, 0x5808002000100ULL, 0x2100060004806104ULL,
+    0x80400880008421ULL, 0x4062220600410280ULL, 0x10a004a00108022ULL, 0x100080080080ULL,
+    0x21000500080010ULL, 0x44000202001008ULL, 0x100400080102ULL, 0xc020128200040545ULL,
+    0x80002000400040ULL, 0x804000802004ULL, 0x120022004080ULL, 0x10a386103001001ULL,
+    0x9010080080800400ULL, 0x8440020080800400ULL, 0x4228824001001ULL, 0x490a000084ULL,
+    0x80002000504000ULL, 0x200020005000c000ULL, 0x12088020420010ULL, 0x10010080080800ULL,
+    0x85001008010004ULL, 0x2000204008080ULL, 0x40413002040008ULL, 0x304081020004ULL,
+    0x80204000800080ULL, 0x3008804000290100ULL, 0x1010100080200080ULL, 0x2008100208028080ULL,
+    0x5000850800910100ULL, 0x8402019004680200ULL, 0x120911028020400ULL, 0x8044010200ULL,
+    0x20850200244012ULL, 0x20850200244012ULL, 0x102001040841ULL, 0x140900040a100021ULL,
+    0x200282410a102ULL, 0x200282410a102ULL, 0x200282410a102ULL, 0x4048240043802106ULL
+};
+
+constexpr uint64_t BISHOP_MAGICS[NUM_SQUARES] = {
+    0x40106000a1160020ULL, 0x20010250810120ULL, 0x2010010220280081ULL, 0x2806004050c040ULL,
+    0x2021018000000ULL, 0x2001112010000400ULL, 0x881010120218080ULL, 0x1030820110010500ULL,
+    0x120222042400ULL, 0x2000020404040044ULL, 0x8000480094208000ULL, 0x3422a02000001ULL,
+    0xa220210100040ULL, 0x8004820202226000ULL, 0x18234854100800ULL, 0x100004042101040ULL,
+    0x4001004082820ULL, 0x10000810010048ULL, 0x1014004208081300ULL, 0x2080818802044202ULL,
+    0x40880c00a00100ULL, 0x80400200522010ULL, 0x1000188180b04ULL, 0x80249202020204ULL,
+    0x1004400004100410ULL, 0x13100a0022206ULL, 0x2148500001040080ULL, 0x4241080011004300ULL,
+    0x4020848004002000ULL, 0x10101380d1004100ULL, 0x8004422020284ULL, 0x1010a1041008080ULL,
+    0x808080400082121ULL, 0x808080400082121ULL, 0x91128200100c00ULL, 0x202200802010104ULL,
+    0x8c0a020200440085ULL, 0x1a0008080b10040ULL, 0x889520080122800ULL, 0x100902022202010aULL,
+    0x4081a0816002000ULL, 0x681208005000ULL, 0x8170840041008802ULL, 0xa00004200810805ULL,
+    0x830404408210100ULL, 0x2602208106006102ULL, 0x1048300680802628ULL, 0x2602208106006102ULL,
+    0x602010120110040ULL, 0x941010801043000ULL, 0x40440a210428ULL, 0x8240020880021ULL,
+    0x400002012048200ULL, 0xac102001210220ULL, 0x220021002009900ULL, 0x84440c080a013080ULL,
+    0x1008044200440ULL, 0x4c04410841000ULL, 0x2000500104011130ULL, 0x1a0c010011c20229ULL,
+    0x44800112202200ULL, 0x434804908100424ULL, 0x300404822c08200ULL, 0x48081010008a2a80ULL
+};
+
+struct SliderEntry {
+    uint64_t mask;  // Relevant blockers, board edges excluded
+    uint64_t magic;
+    uint64_t* attacks;
+    int shift;
+
+    inline unsigned index(uint64_t occupancy) const {
+#if defined(__BMI2__)
+        return (unsigned)_pext_u64(occupancy, mask);
+#else
+        return (unsigned)(((occupancy & mask) * magic) >> shift);
+#endif
+    }
+};
+
+SliderEntry ROOK_ENTRIES[NUM_SQUARES];
+SliderEntry BISHOP_ENTRIES[NUM_SQUARES];
+
+uint64_t ROOK_TABLE[ROOK_TABLE_SIZE];
+uint64_t BISHOP_TABLE[BISHOP_TABLE_SIZE];
+
+inline uint64_t rookAttacks(int square, uint64_t occupancy) {
+    const SliderEntry& entry = ROOK_ENTRIES[square];
+    return entry.attacks[entry.index(occupancy)];
+}
+
+inline uint64_t bishopAttacks(int square, uint64_t occupancy) {
+    const SliderEntry& entry = BISHOP_ENTRIES[square];
+    return entry.attacks[entry.index(occupancy)];
+}
+
+inline uint64_t queenAttacks(int square, uint64_t occupancy) {
+    return rookAttacks(square, occupancy) | bishopAttacks(square, occupancy);
+}
+
+// Walks the rays one square at a time, only used to fill the tables
+constexpr uint64_t slidingAttacks(int square, uint64_t occupancy, int startDirIndex, int endDirIndex) {
+    uint64_t attacks = 0;
+
+    for (int dirIndex = startDirIndex; dirIndex < endDirIndex; dirIndex++) {
+        for (int i = 0; i < Square::MAX_SLIDING_DISTANCE[square][dirIndex]; i++) {
+            int destSquare = square + Square::DIRECTIONS[dirIndex] * (i + 1);
+            attacks |= 1ULL << destSquare;
+
+            if ((occupancy >> destSquare) & 1) break;
+        }
+    }
+
+    return attacks;
+}
+
+using SquareTable = array<uint64_t, NUM_SQUARES>;
+
+template <uint64_t (*SetwiseAttacks)(uint64_t)>
+constexpr SquareTable leaperTable() {
+    SquareTable table = {};
+    for (int square = 0; square < NUM_SQUARES; square++) table[square] = SetwiseAttacks(1ULL << square);
+    return table;
+}
+
+constexpr uint64_t whitePawnAttacks(uint64_t pawns) { return BitBoard::pawnAttacks(pawns, Piece::WHITE); }
+constexpr uint64_t blackPawnAttacks(uint64_t pawns) { return BitBoard::pawnAttacks(pawns, Piece::BLACK); }
+
+constexpr SquareTable KNIGHT_ATTACKS = leaperTable<BitBoard::knightAttacks>();
+constexpr SquareTable KING_ATTACKS = leaperTable<BitBoard::kingAttacks>();
+constexpr SquareTable PAWN_ATTACKS[2] = {leaperTable<whitePawnAttacks>(), leaperTable<blackPawnAttacks>()};
+
+inline uint64_t knightAttacks(int square) { return KNIGHT_ATTACKS[square]; }
+inline uint64_t kingAttacks(int square) { return KING_ATTACKS[square]; }
+
+// Squares a pawn of the given color attacks from square
+inline uint64_t pawnAttacks(int square, int color) { return PAWN_ATTACKS[color == Piece::WHITE ? 0 : 1][square]; }
+
+// Between is true for squares strictly between two aligned squares, the line runs edge to edge through both
+template <bool Between>
+constexpr array<SquareTable, NUM_SQUARES> lineTable() {
+    array<SquareTable, NUM_SQUARES> table = {};
+
+    for (int a = 0; a < NUM_SQUARES; a++) {
+        for (int dirIndex = 0; dirIndex < 8; dirIndex++) {
+            int oppositeIndex = dirIndex < 4 ? dirIndex ^ 1 : 11 - dirIndex;
+            uint64_t line = slidingAttacks(a, 0, dirIndex, dirIndex + 1) |
+                            slidingAttacks(a, 0, oppositeIndex, oppositeIndex + 1) | (1ULL << a);
+            uint64_t between = 0;
+
+            for (int i = 1; i <= Square::MAX_SLIDING_DISTANCE[a][dirIndex]; i++) {
+                int b = a + Square::DIRECTIONS[dirIndex] * i;
+                table[a][b] = Between ? between : line;
+                between |= 1ULL << b;
+            }
+        }
+    }
+
+    return table;
+}
+
+// Squares strictly between two aligned squares, empty if they don't share a rank, file or diagonal
+constexpr array<SquareTable, NUM_SQUARES> BETWEEN = lineTable<true>();
+// The full edge to edge line through two aligned squares, empty if they don't share one
+constexpr array<SquareTable, NUM_SQUARES> LINE = lineTable<false>();
+
+void initSlider(SliderEntry* entries, uint64_t* table, const uint64_t* magics, int startDirIndex, int endDirIndex) {
+    uint64_t* nextSlice = table;
+
+    for (int square = 0; square < NUM_SQUARES; square++) {
+        SliderEntry& entry = entries[square];
+
+        uint64_t edges = ((BitBoard::RANK_1 | BitBoard::RANK_8) & ~(BitBoard::RANK_1 << 8 * Square::rank(square))) |
+                         ((BitBoard::FILE_A | BitBoard::FILE_H) & ~(BitBoard::FILE_A << Square::file(square)));
+
+        entry.mask = slidingAttacks(square, 0, startDirIndex, endDirIndex) & ~edges;
+        entry.magic = magics[square];
+        entry.shift = 64 - BitBoard::getNumToggled(entry.mask);
+        entry.attacks = nextSlice;
+
+        // Enumerate every subset of the mask (Carry-Rippler) and store its attack set
+        uint64_t subset = 0;
+        do {
+            entry.attacks[entry.index(subset)] = slidingAttacks(square, subset, startDirIndex, endDirIndex);
+            nextSlice++;
+            subset = (subset - entry.mask) & entry.mask;
+        } while (subset);
+    }
+}
+
+bool init() {
+    initSlider(ROOK_ENTRIES, ROOK_TABLE, ROOK_MAGICS, 0, 4);
+    initSlider(BISHOP_ENTRIES, BISHOP_TABLE, BISHOP_MAGICS, 4, 8);
+
+    return true;
+}
+
+const bool INITIALIZED = init();
+
+}  // namespace Attacks
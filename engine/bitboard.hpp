@@ -50,7 +50,7 @@ constexpr uint64_t RANK_8 = RANK_1 << 8 * 7;
 
 constexpr int PIECE_BOARDS[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
 
-int getBoardIndex(int piece) {
+constexpr int getBoardIndex(int piece) {
     int index = Piece::getPieceType(piece) - 1;
 
     if (Piece::isColor(piece, Piece::WHITE))
@@ -61,6 +61,9 @@ int getBoardIndex(int piece) {
     throw logic_error("Piece must be black or white in getBoardIndex");
 }
 
+// Occupancy board for a color
+constexpr int getColorIndex(int color) { return color == Piece::WHITE ? ALL_WHITE : ALL_BLACK; }
+
 stackvector<int, NUM_SQUARES> getToggled(uint64_t board) {
     stackvector<int, 64> toggled;
 
@@ -84,6 +87,47 @@ inline void setBit(uint64_t* board, int square) { *board = *board | (1ULL << squ
 
 inline void clearBit(uint64_t* board, int square) { *board = *board & ~(1ULL << square); }
 
+// Shifts towards higher squares for positive offsets, lower squares for negative
+constexpr uint64_t shift(uint64_t board, int offset) { return offset > 0 ? board << offset : board >> -offset; }
+
+// Squares attacked by every pawn on the board of the given color
+constexpr uint64_t pawnAttacks(uint64_t pawns, int color) {
+    if (color == Piece::WHITE) return ((pawns & ~FILE_A) << 7) | ((pawns & ~FILE_H) << 9);
+    return ((pawns & ~FILE_A) >> 9) | ((pawns & ~FILE_H) >> 7);
+}
+
+// Squares attacked by every knight on the board
+constexpr uint64_t knightAttacks(uint64_t knights) {
+    uint64_t attacks = 0;
+
+    attacks |= (knights & ~FILE_A) << 15;             // 2 up, 1 left
+    attacks |= (knights & ~(FILE_A | FILE_B)) << 6;   // 1 up, 2 left
+    attacks |= (knights & ~(FILE_A | FILE_B)) >> 10;  // 1 down, 2 left
+    attacks |= (knights & ~FILE_A) >> 17;             // 2 down, 1 left
+    attacks |= (knights & ~FILE_H) << 17;             // 2 up, 1 right
+    attacks |= (knights & ~(FILE_H | FILE_G)) << 10;  // 1 up, 2 right
+    attacks |= (knights & ~(FILE_H | FILE_G)) >> 6;   // 1 down, 2 right
+    attacks |= (knights & ~FILE_H) >> 15;             // 2 down, 1 right
+
+    return attacks;
+}
+
+// Squares attacked by every king on the board
+constexpr uint64_t kingAttacks(uint64_t kings) {
+    uint64_t attacks = 0;
+
+    attacks |= kings << 8;              // up
+    attacks |= kings >> 8;              // down
+    attacks |= (kings & ~FILE_A) >> 1;  // left
+    attacks |= (kings & ~FILE_A) << 7;  // up left
+    attacks |= (kings & ~FILE_A) >> 9;  // down left
+    attacks |= (kings & ~FILE_H) << 1;  // right
+    attacks |= (kings & ~FILE_H) << 9;  // up right
+    attacks |= (kings & ~FILE_H) >> 7;  // down right
+
+    return attacks;
+}
+
 string visualize(uint64_t board) {
     stringstream visual;
 
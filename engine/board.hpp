@@ -2,155 +2,173 @@
 
 #include <iostream>
 #include <sstream>
-#include <stack>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "attacks.hpp"
 #include "bitboard.hpp"
 #include "helpers.hpp"
 #include "move.hpp"
 #include "piece.hpp"
-#include "positionHash.hpp"
+#include "position.hpp"
 #include "square.hpp"
 #include "stackvector.hpp"
 
 using namespace std;
-using MoveLines = stackvector<MoveLine, MAX_MOVE_LINES>;
-
-// Keeps track of last move data - used to unmake a move
-struct MoveDelta {
-    int movedPiecePos;
-    int takenPiece;
-    int takenPiecePos;
-    int movedPieceEndPos;
-    int originalEnPassant;
-    int originalHalfmove;
-    bool promotion;
-    int originalCastlingRights;
-
-    MoveDelta(int movedPiecePos, int takenPiecePos, int takenPiece, int originalEnPassant, int originalHalfmove,
-              bool promotion, Move originalMove)
-        : movedPiecePos(movedPiecePos),
-          takenPiece(takenPiece),
-          takenPiecePos(takenPiecePos),
-          movedPieceEndPos(takenPiecePos),
-          originalEnPassant(originalEnPassant),
-          originalHalfmove(originalHalfmove),
-          promotion(promotion),
-          originalCastlingRights(0b1111) {};
+using MoveList = stackvector<Move, MAX_MOVES>;
+
+// Move generation modes, every mode only produces legal moves
+namespace GenType {
+constexpr int LEGAL = 0;
+constexpr int CAPTURES = 1;      // Captures, en passant and every promotion
+constexpr int QUIETS = 2;        // Everything else, including castling
+constexpr int EVASIONS = 3;      // Every move when in check
+constexpr int QUIET_CHECKS = 4;  // Quiet moves that give check when not in check
+}  // namespace GenType
+
+// Where each of our piece types would give check, used by quiet check generation
+struct CheckInfo {
+    int kingSquare;
+    uint64_t discoverers;
+    uint64_t squares[Piece::KING + 1];
 };
 
+// What a move destroys, kept per ply so unmaking a move is an index decrement
+struct BoardState {
+    int capturedPiece;
+    int castling;
+    int enPassant;
+    int halfmove;
+    uint64_t key;
+    uint64_t pawnKey;
+    uint64_t materialKey;
+};
+
+#define INITIAL_HISTORY_SIZE 1024  // Plies of history allocated up front, grows for longer games
+#define MAX_FEN_LENGTH 96            // Longest FEN writeFen can produce, with 5 digit move counters
+
 class Board {
    private:
-    int m_board[64] = {0};
-    int m_turn;
-    int m_castling;  // 0b1111, white kingside, white queenside, black kingside, black queenside
-    int m_enPassant;
-    int m_halfmove;
-    int m_fullmove;
+#ifdef COPY_MAKE
+    // One position per ply, making a move copies the current one forward and unmaking steps back
+    vector<Position> m_positions = vector<Position>(INITIAL_HISTORY_SIZE);
+
+    inline Position& pos() { return m_positions[m_ply]; }
+    inline const Position& pos() const { return m_positions[m_ply]; }
+#else
+    Position m_position;
 
-    PositionHash m_positionHash;
+    // m_states[ply] holds what is needed to take back m_moves[ply]
+    vector<BoardState> m_states = vector<BoardState>(INITIAL_HISTORY_SIZE);
 
-    array<uint64_t, NUM_BITBOARDS> m_bitboards = {0};
+    inline Position& pos() { return m_position; }
+    inline const Position& pos() const { return m_position; }
+#endif
 
-    stack<MoveDelta> m_moveHistory;
-    stackvector<Move, MAX_MOVES * 5> m_moveStack;
+    // m_moves[ply] is the move played from ply, m_ply is the current position
+    vector<Move> m_moves = vector<Move>(INITIAL_HISTORY_SIZE);
+    size_t m_ply = 0;
 
     ostream& m_debugStream;
 
-    inline void setSquare(int square, int piece) { setSquare(Square::rank(square), Square::file(square), piece); }
+    // Up to 5 digits that fit in the int16 counters, -1 for anything else
+    static int parseFenNumber(string_view field) {
+        if (field.size() > 5) return -1;
 
-    void setSquare(int rank, int file, int piece) {
-        setBitboard(Square::byRankFile(rank, file), piece);
-        updatePieceHash(Square::byRankFile(rank, file), piece);
+        int value = 0;
+        for (char c : field) {
+            if (c < '0' || c > '9') return -1;
+            value = value * 10 + (c - '0');
+        }
 
-        m_board[rank * 8 + file] = piece;
+        return value <= INT16_MAX ? value : -1;
     }
 
-    void setBitboard(int square, int piece) {
-        int originalPiece = getPiece(square);
+    static char* writeFenNumber(char* out, int value) {
+        char digits[8];
+        int numDigits = 0;
 
-        if (originalPiece != Piece::NONE) {
-            // Clear the bit for the original piece
-            BitBoard::clearBit(&m_bitboards[BitBoard::getBoardIndex(originalPiece)], square);
-        }
+        do {
+            digits[numDigits++] = '0' + value % 10;
+            value /= 10;
+        } while (value > 0);
 
-        if (piece != Piece::NONE) {
-            // Set the bit for the new piece
-            BitBoard::setBit(&m_bitboards[BitBoard::getBoardIndex(piece)], square);
-        }
+        while (numDigits > 0) *out++ = digits[--numDigits];
+        return out;
     }
 
-    void updatePieceHash(int square, int piece) {
-        int originalPiece = getPiece(square);
-
-        // Do nothing if they're the same
-        if (originalPiece == piece) return;
-        // If the original is none and new is something, update new (add)
-        if (originalPiece == Piece::NONE) return m_positionHash.togglePiece(piece, square);
-        // If new is none, and original is something, update original (remove)
-        if (piece == Piece::NONE) return m_positionHash.togglePiece(originalPiece, square);
-
-        // Otherwise its a capture (toggle both)
-        m_positionHash.togglePiece(piece, square);
-        m_positionHash.togglePiece(originalPiece, square);
+    void resizeHistory(size_t size) {
+#ifdef COPY_MAKE
+        m_positions.resize(size);
+#else
+        m_states.resize(size);
+#endif
+        m_moves.resize(size);
     }
 
    public:
     Board(ostream& m_debugStream) : m_debugStream(m_debugStream) {
         setBoard("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
     }
-    Board(ostream& m_debugStream, const string& fen) : m_debugStream(m_debugStream) { setBoard(fen); }
-
-    void setBoard(const string& fen) {
-        // Reset the board and state variables
-        for (int r = 0; r < 8; ++r)
-            for (int f = 0; f < 8; ++f) setSquare(r, f, Piece::NONE);
-
-        m_turn = Piece::WHITE;
-        m_castling = 0;
-        m_enPassant = -1;  // -1 signifies no en passant available
-        m_halfmove = 0;
-        m_fullmove = 1;
-        m_positionHash.reset();
-
-        // Split the FEN string into its components
-        stringstream ss(fen);
-        string piecePlacement, activeColor, castlingAvail, enPassantSquare, halfmoveStr, fullmoveStr;
-
-        if (!(ss >> piecePlacement >> activeColor >> castlingAvail >> enPassantSquare >> halfmoveStr >> fullmoveStr)) {
-            throw invalid_argument("Invalid FEN string: Incorrect number of fields");
-        }
-
-        // Parse piece placement
+    Board(ostream& m_debugStream, string_view fen) : m_debugStream(m_debugStream) { setBoard(fen); }
+
+    // Parses in one pass without allocating, the halfmove clock and fullmove number may be left off as in EPD. The
+    // FEN is parsed on the side and only replaces the current position once all of it is valid, a bad one throws
+    // invalid_argument and leaves the board as it was
+    void setBoard(string_view fen) {
+        Position state;
+        state.clear();
+
+        // Fields are separated by runs of spaces
+        size_t cursor = 0;
+        auto nextField = [&]() {
+            while (cursor < fen.size() && fen[cursor] == ' ') cursor++;
+            size_t start = cursor;
+            while (cursor < fen.size() && fen[cursor] != ' ') cursor++;
+            return fen.substr(start, cursor - start);
+        };
+
+        string_view piecePlacement = nextField();
+        string_view activeColor = nextField();
+        string_view castlingAvail = nextField();
+        string_view enPassantSquare = nextField();
+        string_view halfmoveStr = nextField();
+        string_view fullmoveStr = nextField();
+
+        if (enPassantSquare.empty()) throw invalid_argument("Invalid FEN string: Incorrect number of fields");
+
+        // Parse piece placement, pieces go on without hashing, the key is computed once at the end
         int rank = 7;
         int file = 0;
         for (char c : piecePlacement) {
             if (c == '/') {
+                if (file != 8 || rank == 0) throw invalid_argument("Invalid FEN string: Rank or file out of bounds");
                 rank--;
                 file = 0;
-            } else if (isdigit(c)) {
+            } else if (c >= '1' && c <= '8') {
                 file += c - '0';
+                if (file > 8) throw invalid_argument("Invalid FEN string: Rank or file out of bounds");
             } else {
-                int piece = Piece::fromChar(c);
-
-                if (rank < 0 || rank > 7 || file < 0 || file > 7) {
-                    throw out_of_range("Invalid FEN string: Rank or file out of bounds");
-                }
-
-                setSquare(rank, file, piece);
-                if (piece != Piece::NONE) m_positionHash.togglePiece(piece, Square::byRankFile(rank, file));
+                if (file > 7) throw invalid_argument("Invalid FEN string: Rank or file out of bounds");
 
+                state.putPiece<false>(rank * 8 + file, Piece::fromChar(c));
                 file++;
             }
         }
 
+        if (rank != 0 || file != 8) throw invalid_argument("Invalid FEN string: Piece placement must have 8 full ranks");
+
+        // Move generation needs both kings
+        if (state.getCount(Piece::WHITE | Piece::KING) != 1 || state.getCount(Piece::BLACK | Piece::KING) != 1) {
+            throw invalid_argument("Invalid FEN string: Each side needs exactly one king");
+        }
+
         // Parse active color
         if (activeColor == "w") {
-            m_turn = Piece::WHITE;
+            state.turn = Piece::WHITE;
         } else if (activeColor == "b") {
-            m_turn = Piece::BLACK;
-            m_positionHash.toggleTurn();
+            state.turn = Piece::BLACK;
         } else {
             throw invalid_argument("Invalid FEN string: Active color must be 'w' or 'b'");
         }
@@ -160,16 +178,16 @@ class Board {
             for (char c : castlingAvail) {
                 switch (c) {
                     case 'K':
-                        m_castling |= 8;
+                        state.castling |= 8;
                         break;
                     case 'Q':
-                        m_castling |= 4;
+                        state.castling |= 4;
                         break;
                     case 'k':
-                        m_castling |= 2;
+                        state.castling |= 2;
                         break;
                     case 'q':
-                        m_castling |= 1;
+                        state.castling |= 1;
                         break;
                     default:
                         throw invalid_argument("Invalid FEN string: Invalid castling availability");
@@ -177,102 +195,118 @@ class Board {
             }
         }
 
-        m_positionHash.toggleCastlingRights(m_castling);
-
         // Parse en passant square
         if (enPassantSquare != "-") {
             if (enPassantSquare.length() != 2 || enPassantSquare[0] < 'a' || enPassantSquare[0] > 'h' ||
                 enPassantSquare[1] < '1' || enPassantSquare[1] > '8') {
                 throw invalid_argument("Invalid FEN string: Invalid en passant square");
             }
-            char fileChar = enPassantSquare[0];
-            char rankChar = enPassantSquare[1];
-            int epFile = fileChar - 'a';
-            int epRank = (rankChar - '1');  // 0-based index
-            m_enPassant = Square::byRankFile(epRank, epFile);
 
-            m_positionHash.toggleEnPassant(epFile);
+            state.enPassant = (enPassantSquare[1] - '1') * 8 + (enPassantSquare[0] - 'a');
+
+            // Only right behind an enemy pawn that just moved two squares, on the 6th rank for White to move
+            int them = Piece::getOppositeColor(state.turn);
+            int pushedTo = state.enPassant + (state.turn == Piece::WHITE ? -8 : 8);
+            if (Square::rank(state.enPassant) != (state.turn == Piece::WHITE ? 5 : 2) ||
+                state.board[state.enPassant] != Piece::NONE || state.board[pushedTo] != (them | Piece::PAWN)) {
+                throw invalid_argument("Invalid FEN string: En passant square without a pawn that just moved two");
+            }
+        }
+
+        // Each castling right needs its king and rook still on their starting squares
+        // Right bit, king square, rook square
+        constexpr int CASTLING_SQUARES[4][3] = {{0b1000, Square::E1, Square::H1},
+                                                {0b0100, Square::E1, Square::A1},
+                                                {0b0010, Square::E8, Square::H8},
+                                                {0b0001, Square::E8, Square::A8}};
+        for (const int* squares : CASTLING_SQUARES) {
+            int color = squares[1] == Square::E1 ? Piece::WHITE : Piece::BLACK;
+
+            if ((state.castling & squares[0]) &&
+                (state.board[squares[1]] != (color | Piece::KING) || state.board[squares[2]] != (color | Piece::ROOK))) {
+                throw invalid_argument("Invalid FEN string: Castling rights without the king and rook at home");
+            }
         }
 
         // Parse halfmove clock
-        try {
-            m_halfmove = stoi(halfmoveStr);
-            if (m_halfmove < 0) throw invalid_argument("Halfmove clock cannot be negative");
-        } catch (...) {
-            throw invalid_argument("Invalid FEN string: Invalid halfmove clock");
+        if (!halfmoveStr.empty()) {
+            state.halfmove = parseFenNumber(halfmoveStr);
+            if (state.halfmove < 0) throw invalid_argument("Invalid FEN string: Invalid halfmove clock");
         }
 
         // Parse fullmove number
-        try {
-            m_fullmove = stoi(fullmoveStr);
-            if (m_fullmove <= 0) throw invalid_argument("Fullmove number must be positive");
-        } catch (...) {
-            throw invalid_argument("Invalid FEN string: Invalid fullmove number");
+        if (!fullmoveStr.empty()) {
+            state.fullmove = parseFenNumber(fullmoveStr);
+            if (state.fullmove <= 0) throw invalid_argument("Invalid FEN string: Invalid fullmove number");
         }
+
+        state.computeKeys();
+
+        m_ply = 0;
+        pos() = state;
     }
 
-    string getFen() const {
-        string fen = "";
+    // Writes the FEN into buffer, which needs room for MAX_FEN_LENGTH characters. Returns the number of characters
+    // written, no null terminator is added
+    size_t writeFen(char* buffer) const {
+        const Position& state = pos();
+        char* out = buffer;
 
         // 1. Piece Placement
         for (int r = 7; r >= 0; --r) {  // Start from rank 8 to 1
             int emptySquares = 0;
             for (int f = 0; f < 8; ++f) {  // File a to h
-                int piece = getPiece(r, f);
-                if (piece == 0) {
+                int piece = state.board[r * 8 + f];
+                if (piece == Piece::NONE) {
                     emptySquares++;
-                } else {
-                    if (emptySquares > 0) {
-                        fen += to_string(emptySquares);
-                        emptySquares = 0;
-                    }
-
-                    fen += Piece::toChar(piece);
+                    continue;
                 }
+
+                if (emptySquares > 0) *out++ = '0' + emptySquares;
+                emptySquares = 0;
+
+                *out++ = Piece::toChar(piece);
             }
-            if (emptySquares > 0) {
-                fen += to_string(emptySquares);
-            }
-            if (r > 0) {
-                fen += '/';
-            }
+
+            if (emptySquares > 0) *out++ = '0' + emptySquares;
+            if (r > 0) *out++ = '/';
         }
 
         // 2. Active Color
-        fen += ' ';
-        fen += (m_turn == Piece::WHITE) ? 'w' : 'b';
+        *out++ = ' ';
+        *out++ = state.turn == Piece::WHITE ? 'w' : 'b';
 
         // 3. Castling Availability
-        fen += ' ';
-        string castlingStr = "";
-        if (m_castling & 8) castlingStr += 'K';
-        if (m_castling & 4) castlingStr += 'Q';
-        if (m_castling & 2) castlingStr += 'k';
-        if (m_castling & 1) castlingStr += 'q';
-        if (castlingStr.empty()) castlingStr = "-";
-        fen += castlingStr;
+        *out++ = ' ';
+        if (state.castling & 8) *out++ = 'K';
+        if (state.castling & 4) *out++ = 'Q';
+        if (state.castling & 2) *out++ = 'k';
+        if (state.castling & 1) *out++ = 'q';
+        if (state.castling == 0) *out++ = '-';
 
         // 4. En Passant Target Square
-        fen += ' ';
-        if (m_enPassant == -1) {
-            fen += '-';
+        *out++ = ' ';
+        if (state.enPassant == -1) {
+            *out++ = '-';
         } else {
-            int epRank = m_enPassant / 8;
-            int epFile = m_enPassant % 8;
-            char fileChar = 'a' + epFile;
-            char rankChar = '1' + epRank;
-            fen += string{fileChar, rankChar};
+            *out++ = 'a' + Square::file(state.enPassant);
+            *out++ = '1' + Square::rank(state.enPassant);
         }
 
         // 5. Halfmove Clock
-        fen += ' ';
-        fen += to_string(m_halfmove);
+        *out++ = ' ';
+        out = writeFenNumber(out, state.halfmove);
 
         // 6. Fullmove Number
-        fen += ' ';
-        fen += to_string(m_fullmove);
+        *out++ = ' ';
+        out = writeFenNumber(out, state.fullmove);
 
-        return fen;
+        return out - buffer;
+    }
+
+    string getFen() const {
+        char buffer[MAX_FEN_LENGTH];
+        return string(buffer, writeFen(buffer));
     }
 
     string visualizeBoard(bool includeFen = true) {
@@ -290,440 +324,561 @@ class Board {
 
         if (includeFen) {
             visual << "\nBoard Fen: " << getFen() << endl;
-            visual << "HASH: " << m_positionHash.get() << endl;
+            visual << "HASH: " << pos().hash.get() << endl;
         }
 
         return visual.str();
     }
 
-    string uciMoveStack() { return arrToString(Move::getUciArr(m_moveStack)); }
+    string uciMoveStack() {
+        vector<string> uciMoves;
+        for (size_t ply = 0; ply < m_ply; ply++) uciMoves.push_back(m_moves[ply].toUci());
+
+        return vecToString(uciMoves, true);
+    }
 
-    inline int getTurn() { return m_turn; }
-    inline int getNextTurn() { return m_turn == Piece::WHITE ? Piece::BLACK : Piece::WHITE; }
+    inline int getTurn() { return pos().turn; }
+    inline int getNextTurn() { return pos().turn == Piece::WHITE ? Piece::BLACK : Piece::WHITE; }
 
     inline int getPiece(int rank, int file) const { return getPiece(rank * 8 + file); }
-    inline int getPiece(int square) const { return m_board[square]; }
+    inline int getPiece(int square) const { return pos().board[square]; }
 
     stackvector<Move, MAX_MOVES> generateLegalMoves() {
-        stackvector<Move, MAX_MOVES> moves;
-        MoveLines pinLines = generateMoveLines(m_turn, MoveLine::PIN);
-        MoveLines checkLines = generateMoveLines(m_turn, MoveLine::CHECK);
-
-        for (int square : Square::ALL_SQUARES) {
-            if (getPiece(square) == Piece::NONE) continue;
-            if (!Piece::isColor(getPiece(square), m_turn)) continue;
-
-            moves.append(generateMovesForPiece(square, getPiece(square), checkLines, pinLines));
-        }
+        MoveList moves;
+        generateMoves<GenType::LEGAL>(moves);
 
         return moves;
     }
 
-    stackvector<Move, MAX_PIECE_MOVES> generateMovesForPiece(int startSquare, int piece, const MoveLines& checkLines,
-                                                             const MoveLines& pinLines) {
-        stackvector<Move, MAX_PIECE_MOVES> moves;
+    // Appends the legal moves of the given GenType to the caller's list
+    template <int Type>
+    void generateMoves(MoveList& moves) {
+        if (pos().turn == Piece::WHITE)
+            generateMoves<Type, Piece::WHITE>(moves);
+        else
+            generateMoves<Type, Piece::BLACK>(moves);
+    }
 
-        switch (Piece::getPieceType(piece)) {
-            case Piece::BISHOP:
-            case Piece::ROOK:
-            case Piece::QUEEN:
-                moves.append(generateSlidingMoves(startSquare, piece, checkLines, pinLines));
-                break;
-            case Piece::PAWN:
-                moves.append(generatePawnMoves(startSquare, piece, checkLines, pinLines));
-                break;
+    template <int Type, int Us>
+    void generateMoves(MoveList& moves) {
+        constexpr int Them = Piece::getOppositeColor(Us);
 
-            case Piece::KNIGHT:
-                moves.append(generateKnightMoves(startSquare, piece, checkLines, pinLines));
-                break;
+        uint64_t kingBitboard = getBitboard(Us | Piece::KING);
+        if (kingBitboard == 0) return;
 
-            case Piece::KING:
-                moves.append(generateKingMoves(startSquare, piece, checkLines));
-                break;
+        int kingSquare = __builtin_ctzll(kingBitboard);
+        uint64_t checkers = getCheckers(kingSquare, Us);
 
-            default:
-                break;
-        }
+        if (Type == GenType::EVASIONS && !checkers) throw logic_error("Evasions requested when not in check");
+        if (Type == GenType::QUIET_CHECKS && checkers) throw logic_error("Quiet checks requested when in check");
 
-        return moves;
-    }
+        uint64_t typeMask = ~getColorBitboard(Us);
+        if (Type == GenType::CAPTURES) typeMask = getColorBitboard(Them);
+        if (Type == GenType::QUIETS || Type == GenType::QUIET_CHECKS) typeMask = ~getOccupancy();
 
-    stackvector<Move, MAX_PIECE_MOVES> generateSlidingMoves(int startSquare, int piece, const MoveLines& checkLines,
-                                                            const MoveLines& pinLines) {
-        int startDirIndex = Piece::isType(piece, Piece::BISHOP) ? 4 : 0;
-        int endDirIndex = Piece::isType(piece, Piece::ROOK) ? 4 : 8;
+        // Slide through the king so it can't step back along the checking ray
+        uint64_t enemyAttacks = getAttackedSquares(Them, getOccupancy() ^ kingBitboard);
 
-        stackvector<Move, MAX_PIECE_MOVES> moves;
+        // If double check, gg (only king moves)
+        if (BitBoard::getNumToggled(checkers) > 1)
+            return generateKingMoves<Type, Us>(moves, kingSquare, checkers, enemyAttacks, typeMask);
 
-        MoveLine pinLine = getPinLine(pinLines, startSquare);
+        // Non king moves must capture the checker or block the check
+        uint64_t checkMask = ~0ULL;
+        if (checkers) checkMask = checkers | Attacks::BETWEEN[kingSquare][__builtin_ctzll(checkers)];
 
-        // If double check, gg (no moves)
-        MoveLine checkLine;
-        if (checkLines.size() > 1) return moves;
-        if (checkLines.size() == 1) checkLine = checkLines[0];
+        uint64_t pinned = getBlockers(kingSquare, Them, getColorBitboard(Us));
 
-        for (int dirIndex = startDirIndex; dirIndex < endDirIndex; dirIndex++) {
-            int dir = Square::DIRECTIONS[dirIndex];
+        CheckInfo checkInfo{};
+        if (Type == GenType::QUIET_CHECKS) checkInfo = getCheckInfo();
 
-            // Go only the number of squares in the direction that actually exist
-            for (int i = 0; i < Square::MAX_SLIDING_DISTANCE[startSquare][dirIndex]; i++) {
-                Move candidateMove;
+        generatePawnMoves<Type, Us>(moves, kingSquare, checkMask, pinned, checkInfo);
 
-                int destSquare = startSquare + dir * (i + 1);
-                if (!Square::isOnBoard(destSquare)) {
-                    break;
-                }
+        for (int pieceType : {Piece::KNIGHT, Piece::BISHOP, Piece::ROOK, Piece::QUEEN})
+            generatePieceMoves<Type, Us>(moves, pieceType, kingSquare, typeMask & checkMask, pinned, checkInfo);
 
-                int destPiece = getPiece(destSquare);
+        generateKingMoves<Type, Us>(moves, kingSquare, checkers, enemyAttacks, typeMask);
+    }
 
-                if (destPiece == Piece::NONE) {
-                    candidateMove = Move(startSquare, destSquare);
-                    if (inValidMoveLines(candidateMove, checkLine, pinLine)) moves.push_back(candidateMove);
+    // Knight and slider moves landing on targetMask, pinned pieces stay on their pin ray
+    template <int Type, int Us>
+    void generatePieceMoves(MoveList& moves, int pieceType, int kingSquare, uint64_t targetMask, uint64_t pinned,
+                            const CheckInfo& checkInfo) {
+        uint64_t pieces = getBitboard(Us | pieceType);
+        uint64_t occupancy = getOccupancy();
 
-                } else {
-                    if (Piece::isColor(destPiece, m_turn)) {
-                        break;
-                    } else {
-                        candidateMove = Move(startSquare, destSquare);
-                        if (inValidMoveLines(candidateMove, checkLine, pinLine)) moves.push_back(candidateMove);
-                        break;
-                    }
-                }
+        while (pieces) {
+            int startSquare = __builtin_ctzll(pieces);
+            pieces &= pieces - 1;
+
+            uint64_t targets = getPieceAttacks(pieceType, startSquare, occupancy) & targetMask;
+            if (BitBoard::getBit(pinned, startSquare)) targets &= Attacks::LINE[kingSquare][startSquare];
+
+            if (Type == GenType::QUIET_CHECKS) {
+                uint64_t checking = checkInfo.squares[pieceType];
+
+                // Leaving the line between our slider and their king uncovers a check from anywhere
+                if (BitBoard::getBit(checkInfo.discoverers, startSquare))
+                    checking |= ~Attacks::LINE[checkInfo.kingSquare][startSquare];
+
+                targets &= checking;
             }
-        }
 
-        return moves;
+            Move* out = moves.tail();
+            while (targets) {
+                *out++ = Move(startSquare, __builtin_ctzll(targets));
+                targets &= targets - 1;
+            }
+            moves.commit(out);
+        }
     }
 
-    stackvector<Move, MAX_PIECE_MOVES> generatePawnMoves(int startSquare, int piece, const MoveLines& checkLines,
-                                                         const MoveLines& pinLines) {
-        stackvector<Move, MAX_PIECE_MOVES> moves;
+    template <int Type, int Us>
+    void generatePawnMoves(MoveList& moves, int kingSquare, uint64_t checkMask, uint64_t pinned,
+                           const CheckInfo& checkInfo) {
+        constexpr int Them = Piece::getOppositeColor(Us);
+        constexpr int dir = Us == Piece::WHITE ? 8 : -8;
+        constexpr uint64_t promotionRank = Us == Piece::WHITE ? BitBoard::RANK_8 : BitBoard::RANK_1;
+        constexpr uint64_t doublePushRank = Us == Piece::WHITE ? BitBoard::RANK_3 : BitBoard::RANK_6;
 
-        MoveLine pinLine = getPinLine(pinLines, startSquare);
+        uint64_t pawns = getBitboard(Us | Piece::PAWN);
+        uint64_t empty = ~getOccupancy();
+        uint64_t enemies = getColorBitboard(Them);
 
-        // If double check, gg (no moves)
-        MoveLine checkLine;
-        if (checkLines.size() > 1) return moves;
-        if (checkLines.size() == 1) checkLine = checkLines[0];
+        // Captures and all promotions belong to CAPTURES, everything else to QUIETS
+        uint64_t pushMask = ~0ULL;
+        if (Type == GenType::CAPTURES) pushMask = promotionRank;
+        if (Type == GenType::QUIETS || Type == GenType::QUIET_CHECKS) pushMask = ~promotionRank;
 
-        int dir = Piece::isColor(piece, Piece::WHITE) ? 8 : -8;
+        uint64_t singlePush = BitBoard::shift(pawns, dir) & empty;
+        uint64_t doublePush = BitBoard::shift(singlePush & doublePushRank, dir) & empty;
 
-        // Single move
-        int destSquare = startSquare + dir;
-        if (Square::isOnBoard(destSquare) && getPiece(destSquare) == Piece::NONE) {
-            Move candidateMove = Move(startSquare, destSquare);
+        singlePush &= pushMask & checkMask;
+        doublePush &= pushMask & checkMask;
 
-            if (inValidMoveLines(candidateMove, checkLine, pinLine)) {
-                if (Square::rank(destSquare) == 0 || Square::rank(destSquare) == 7) {
-                    moves.push_back(Move(startSquare, destSquare, Flag::PROMOTION_QUEEN));
-                    moves.push_back(Move(startSquare, destSquare, Flag::PROMOTION_ROOK));
-                    moves.push_back(Move(startSquare, destSquare, Flag::PROMOTION_BISHOP));
-                    moves.push_back(Move(startSquare, destSquare, Flag::PROMOTION_KNIGHT));
+        if (Type == GenType::QUIET_CHECKS) {
+            // A push never leaves a file, so only pawns uncovering a rank or diagonal give discovered check
+            uint64_t discoverers = pawns & checkInfo.discoverers & ~(BitBoard::FILE_A << Square::file(checkInfo.kingSquare));
 
-                } else {
-                    moves.push_back(Move(startSquare, destSquare));
-                }
-            }
+            singlePush &= checkInfo.squares[Piece::PAWN] | BitBoard::shift(discoverers, dir);
+            doublePush &= checkInfo.squares[Piece::PAWN] | BitBoard::shift(discoverers, 2 * dir);
         }
 
-        // Double move
-        if ((Piece::isColor(piece, Piece::WHITE) && Square::rank(startSquare) == 1) ||
-            (Piece::isColor(piece, Piece::BLACK) && Square::rank(startSquare) == 6)) {
-            int doubleDestSquare = startSquare + 2 * dir;
-            if (getPiece(destSquare) == Piece::NONE && getPiece(doubleDestSquare) == Piece::NONE) {
-                Move candidateMove = Move(startSquare, doubleDestSquare);
-                if (inValidMoveLines(candidateMove, checkLine, pinLine))
-                    moves.push_back(Move(startSquare, doubleDestSquare));
-            }
-        }
+        addPawnMoves(moves, singlePush, dir, kingSquare, pinned);
+        addPawnMoves(moves, doublePush, 2 * dir, kingSquare, pinned);
 
-        // Capture moves
-        for (int i = -1; i <= 1; i += 2) {
-            destSquare = startSquare + dir + i;
-            if (Square::rank(destSquare) != Square::rank(startSquare + dir)) continue;
+        if (Type == GenType::QUIETS || Type == GenType::QUIET_CHECKS) return;
 
-            if (Square::isOnBoard(destSquare) && Piece::isColor(getPiece(destSquare), m_turn ^ Piece::COLOR_MASK)) {
-                Move candidateMove = Move(startSquare, destSquare);
-                if (inValidMoveLines(candidateMove, checkLine, pinLine)) {
-                    if (Square::rank(destSquare) == 0 || Square::rank(destSquare) == 7) {
-                        moves.push_back(Move(startSquare, destSquare, Flag::PROMOTION_QUEEN));
-                        moves.push_back(Move(startSquare, destSquare, Flag::PROMOTION_ROOK));
-                        moves.push_back(Move(startSquare, destSquare, Flag::PROMOTION_BISHOP));
-                        moves.push_back(Move(startSquare, destSquare, Flag::PROMOTION_KNIGHT));
+        // Captures towards the A file and towards the H file
+        uint64_t leftCaptures = BitBoard::shift(pawns & ~BitBoard::FILE_A, dir - 1) & enemies & checkMask;
+        uint64_t rightCaptures = BitBoard::shift(pawns & ~BitBoard::FILE_H, dir + 1) & enemies & checkMask;
 
-                    } else {
-                        moves.push_back(Move(startSquare, destSquare));
-                    }
-                }
-            }
-            // enpassant
-            if (Square::isOnBoard(destSquare) && destSquare == m_enPassant) {
-                Move candidateMove = Move(startSquare, destSquare);
+        addPawnMoves(moves, leftCaptures, dir - 1, kingSquare, pinned);
+        addPawnMoves(moves, rightCaptures, dir + 1, kingSquare, pinned);
 
-                makeMove(candidateMove);
-                m_turn = getNextTurn();
-                bool causedCheck = isCheck();
-                m_turn = getNextTurn();
-                unmakeLastMove();
+        int enPassant = pos().enPassant;
+        if (enPassant == -1) return;
 
-                if (!causedCheck) moves.push_back(candidateMove);
-            }
-        }
+        // enpassant
+        int capturedSquare = enPassant - dir;
+        uint64_t capturers = Attacks::pawnAttacks(enPassant, Them) & pawns;
 
-        return moves;
-    }
+        // The captured pawn must be the checker, or the landing square must block the check
+        if (!(checkMask & ((1ULL << enPassant) | (1ULL << capturedSquare)))) return;
 
-    stackvector<Move, MAX_PIECE_MOVES> generateKnightMoves(int startSquare, int piece, const MoveLines& checkLines,
-                                                           const MoveLines& pinLines) {
-        stackvector<Move, MAX_PIECE_MOVES> moves;
+        while (capturers) {
+            int startSquare = __builtin_ctzll(capturers);
+            capturers &= capturers - 1;
 
-        MoveLine pinLine = getPinLine(pinLines, startSquare);
+            // Both pawns leave their squares at once, so look for any slider that is revealed on the king
+            uint64_t occupancy =
+                (getOccupancy() ^ (1ULL << startSquare) ^ (1ULL << capturedSquare)) | (1ULL << enPassant);
 
-        // If double check, gg (no moves)
-        MoveLine checkLine;
-        if (checkLines.size() > 1) return moves;
-        if (checkLines.size() == 1) checkLine = checkLines[0];
+            if (!getSliderAttackers(kingSquare, Them, occupancy))
+                moves.emplace_back(startSquare, enPassant, Flag::EN_PASSANT);
+        }
+    }
 
-        for (int rankOff = -2; rankOff <= 2; rankOff++) {
-            for (int fileOff = -2; fileOff <= 2; fileOff++) {
-                int destSquare = startSquare + fileOff + rankOff * 8;
-                if (abs(rankOff) + abs(fileOff) != 3) continue;
-                if (!Square::isOnBoard(destSquare)) continue;
-                if (Square::rank(destSquare) != Square::rank(startSquare) + rankOff) continue;
-                if (Square::file(destSquare) != Square::file(startSquare) + fileOff) continue;
+    void addPawnMoves(MoveList& moves, uint64_t targets, int offset, int kingSquare, uint64_t pinned) {
+        Move* out = moves.tail();
 
-                if (Piece::isColor(getPiece(destSquare), m_turn)) continue;
+        while (targets) {
+            int destSquare = __builtin_ctzll(targets);
+            targets &= targets - 1;
 
-                Move candidateMove = Move(startSquare, destSquare);
+            int startSquare = destSquare - offset;
+            if (BitBoard::getBit(pinned, startSquare) && !BitBoard::getBit(Attacks::LINE[kingSquare][startSquare], destSquare))
+                continue;
 
-                if (inValidMoveLines(candidateMove, checkLine, pinLine)) moves.push_back(candidateMove);
+            if (Square::rank(destSquare) == 0 || Square::rank(destSquare) == 7) {
+                *out++ = Move(startSquare, destSquare, Flag::PROMOTION_QUEEN);
+                *out++ = Move(startSquare, destSquare, Flag::PROMOTION_ROOK);
+                *out++ = Move(startSquare, destSquare, Flag::PROMOTION_BISHOP);
+                *out++ = Move(startSquare, destSquare, Flag::PROMOTION_KNIGHT);
+            } else {
+                *out++ = Move(startSquare, destSquare);
             }
         }
-        return moves;
+
+        moves.commit(out);
     }
 
-    stackvector<Move, MAX_PIECE_MOVES> generateKingMoves(int startSquare, int piece, const MoveLines& checkLines) {
-        stackvector<Move, MAX_PIECE_MOVES> moves;
+    template <int Type, int Us>
+    void generateKingMoves(MoveList& moves, int startSquare, uint64_t checkers, uint64_t enemyAttacks,
+                           uint64_t typeMask) {
+        uint64_t targets = Attacks::kingAttacks(startSquare) & typeMask & ~enemyAttacks;
 
-        bool inCheck = checkLines.size() != 0;
+        while (targets) {
+            Move move = Move(startSquare, __builtin_ctzll(targets));
+            targets &= targets - 1;
 
-        for (int rankOff = -1; rankOff <= 1; rankOff++) {
-            for (int fileOff = -1; fileOff <= 1; fileOff++) {
-                int targetSquare = startSquare + fileOff + rankOff * 8;
+            // The king only ever gives a discovered check, rare enough to test directly
+            if (Type != GenType::QUIET_CHECKS || givesCheck(move)) moves.push_back(move);
+        }
 
-                if (!Square::isOnBoard(targetSquare)) continue;
-                if (Square::rank(targetSquare) != Square::rank(startSquare) + rankOff) continue;
-                if (Square::file(targetSquare) != Square::file(startSquare) + fileOff) continue;
-                if (Piece::isColor(getPiece(targetSquare), m_turn)) continue;
+        if (Type == GenType::CAPTURES || Type == GenType::EVASIONS) return;
+        if (checkers) return;  // Can't castle out of check
 
-                // Make sure the move doesn't put the king in check
-                Move candidateMove = Move(startSquare, targetSquare);
+        // Castling, rights mean the king and rook are still on their starting squares
+        constexpr int rightsShift = Us == Piece::WHITE ? 2 : 0;
+        constexpr int kingStart = Us == Piece::WHITE ? Square::E1 : Square::E8;
+        constexpr uint64_t queenSidePath = (1ULL << (kingStart - 1)) | (1ULL << (kingStart - 2));
+        constexpr uint64_t queenSideBetween = queenSidePath | (1ULL << (kingStart - 3));
+        constexpr uint64_t kingSidePath = (1ULL << (kingStart + 1)) | (1ULL << (kingStart + 2));
 
-                makeMove(candidateMove);
-                m_turn = getNextTurn();
-                bool causedCheck = isCheck();
-                m_turn = getNextTurn();
-                unmakeLastMove();
+        if (startSquare != kingStart) return;  // Never castle from a square the king isn't on
 
-                if (!causedCheck) moves.push_back(candidateMove);
-            }
+        int rights = (pos().castling >> rightsShift) & 0b11;
+        uint64_t occupancy = getOccupancy();
+
+        // Queen side, the king can't pass through or land on an attacked square
+        if (rights & 0b01) {
+            Move move = Move(startSquare, startSquare - 2, Flag::CASTLE);
+
+            if (!(occupancy & queenSideBetween) && !(enemyAttacks & queenSidePath) &&
+                (Type != GenType::QUIET_CHECKS || givesCheck(move)))
+                moves.push_back(move);
         }
 
-        if (inCheck) return moves;  // Don't bother calculating castling if in check
+        // King side
+        if (rights & 0b10) {
+            Move move = Move(startSquare, startSquare + 2, Flag::CASTLE);
+
+            if (!(occupancy & kingSidePath) && !(enemyAttacks & kingSidePath) &&
+                (Type != GenType::QUIET_CHECKS || givesCheck(move)))
+                moves.push_back(move);
+        }
+    }
 
-        // Castling
-        int rights = m_castling & (Piece::isColor(piece, Piece::WHITE) ? 0b1100 : 0b11);
-        rights = rights >> (Piece::isColor(piece, Piece::WHITE) ? 2 : 0);
+    // Squares each of our piece types would check the enemy king from, plus our pieces blocking our own sliders
+    CheckInfo getCheckInfo() {
+        CheckInfo checkInfo{};
 
-        // Queen side
-        if (rights & 0b01) {
-            bool blocked = false;
-            bool passesCheck = true;
-            for (int fileOff = 1; fileOff <= 3; fileOff++) {
-                if (getPiece(Square::rank(startSquare), Square::file(startSquare) - fileOff) != Piece::NONE)
-                    blocked = true;
-            }
+        uint64_t occupancy = getOccupancy();
+        int kingSquare = __builtin_ctzll(getBitboard(getNextTurn() | Piece::KING));
 
-            for (Move move : moves) {
-                if (move.getTo() == startSquare - 1) {
-                    passesCheck = false;
-                    break;
-                }
-            }
+        checkInfo.kingSquare = kingSquare;
+        checkInfo.discoverers = getBlockers(kingSquare, pos().turn, getColorBitboard(pos().turn));
 
-            if (!blocked && !passesCheck) {
-                Move candidateMove = Move(startSquare, startSquare - 2);
+        checkInfo.squares[Piece::PAWN] = Attacks::pawnAttacks(kingSquare, getNextTurn());
+        checkInfo.squares[Piece::KNIGHT] = Attacks::knightAttacks(kingSquare);
+        checkInfo.squares[Piece::BISHOP] = Attacks::bishopAttacks(kingSquare, occupancy);
+        checkInfo.squares[Piece::ROOK] = Attacks::rookAttacks(kingSquare, occupancy);
+        checkInfo.squares[Piece::QUEEN] = checkInfo.squares[Piece::BISHOP] | checkInfo.squares[Piece::ROOK];
+        checkInfo.squares[Piece::KING] = 0;
 
-                makeMove(candidateMove);
-                m_turn = getNextTurn();
-                bool causedCheck = isCheck();
-                m_turn = getNextTurn();
-                unmakeLastMove();
+        return checkInfo;
+    }
 
-                if (!causedCheck) moves.push_back(candidateMove);
-            }
-        }
+    // Returns if the (legal) move puts the opponent in check
+    bool givesCheck(const Move& move) {
+        int from = move.getFrom();
+        int to = move.getTo();
+        int movedPiece = getPiece(from);
+        int pieceType = move.isPromotion() ? move.getPromotionPiece() : Piece::getPieceType(movedPiece);
 
-        // King side
-        if (rights & 0b10) {
-            bool blocked = false;
-            bool passesCheck = true;
+        uint64_t enemyKing = getBitboard(getNextTurn() | Piece::KING);
+        if (enemyKing == 0) return false;
 
-            for (int fileOff = 1; fileOff <= 2; fileOff++) {
-                if (getPiece(Square::rank(startSquare), Square::file(startSquare) + fileOff) != Piece::NONE)
-                    blocked = true;
-            }
+        int kingSquare = __builtin_ctzll(enemyKing);
+        uint64_t occupancy = (getOccupancy() ^ (1ULL << from)) | (1ULL << to);
 
-            for (Move move : moves) {
-                if (move.getTo() == startSquare + 1) {
-                    passesCheck = false;
-                    break;
-                }
-            }
+        // Direct check from the moved piece
+        if (pieceType == Piece::PAWN) {
+            if (Attacks::pawnAttacks(to, pos().turn) & enemyKing) return true;
+        } else if (pieceType != Piece::KING) {
+            if (getPieceAttacks(pieceType, to, occupancy) & enemyKing) return true;
+        }
 
-            if (!blocked && !passesCheck) {
-                Move candidateMove = Move(startSquare, startSquare + 2);
+        if (move.isEnPassant()) occupancy ^= 1ULL << (to + (pos().turn == Piece::WHITE ? -8 : 8));
 
-                makeMove(candidateMove);
-                m_turn = getNextTurn();
-                bool causedCheck = isCheck();
-                m_turn = getNextTurn();
-                unmakeLastMove();
+        // The castling rook checks along the back rank or the file
+        if (move.isCastle()) {
+            int rookFrom = to > from ? from + 3 : from - 4;
+            int rookTo = to > from ? from + 1 : from - 1;
 
-                if (!causedCheck) moves.push_back(candidateMove);
-            }
+            occupancy = (occupancy ^ (1ULL << rookFrom)) | (1ULL << rookTo);
+            if (Attacks::rookAttacks(rookTo, occupancy) & enemyKing) return true;
         }
 
-        return moves;
+        // Discovered check, our sliders still sit on their squares apart from the moved piece
+        return getSliderAttackers(kingSquare, pos().turn, occupancy) & ~(1ULL << from);
     }
 
-    stackvector<int, NUM_SQUARES> getPieceLocations(int piece) {
-        return BitBoard::getToggled(m_bitboards[BitBoard::getBoardIndex(piece)]);
+    // True if the move could come out of the move generator before checking the king, so any 16 bits from a hash
+    // table, killer slot or the GUI can be tested without generating. Castling is checked in full here
+    bool isPseudoLegal(const Move move) {
+        return pos().turn == Piece::WHITE ? isPseudoLegal<Piece::WHITE>(move) : isPseudoLegal<Piece::BLACK>(move);
     }
 
-    // 0 - checkLine, 1 - pinLine
-    // Warning: Only calculates for a single king
-    MoveLines generateMoveLines(int kingColor, int lineType) {
-        MoveLines moveLines;
-
-        auto kingLocations = getPieceLocations(kingColor | Piece::KING);
+    template <int Us>
+    bool isPseudoLegal(const Move move) {
+        constexpr int Them = Piece::getOppositeColor(Us);
+        constexpr int dir = Us == Piece::WHITE ? 8 : -8;
+        constexpr uint64_t promotionRank = Us == Piece::WHITE ? BitBoard::RANK_8 : BitBoard::RANK_1;
+        constexpr uint64_t doublePushRank = Us == Piece::WHITE ? BitBoard::RANK_4 : BitBoard::RANK_5;
+        constexpr int kingStart = Us == Piece::WHITE ? Square::E1 : Square::E8;
+        constexpr int rightsShift = Us == Piece::WHITE ? 2 : 0;
+
+        int from = move.getFrom();
+        int to = move.getTo();
+        int piece = getPiece(from);
+        int flags = move.getFlags();
+        uint64_t toBit = 1ULL << to;
+        uint64_t occupancy = getOccupancy();
+
+        // Flags 0b0011 and 0b01xx are never used
+        if ((flags & 0b0100) || flags == 0b0011) return false;
+        if (from == to || piece == Piece::NONE || !Piece::isColor(piece, Us)) return false;
+        if (toBit & getColorBitboard(Us)) return false;
+
+        int pieceType = Piece::getPieceType(piece);
+
+        if (flags == Flag::CASTLE) {
+            if (pieceType != Piece::KING || from != kingStart || (to != from + 2 && to != from - 2)) return false;
+
+            bool kingSide = to > from;
+            uint64_t path = kingSide ? (toBit | (toBit >> 1)) : (toBit | (toBit << 1));
+            uint64_t between = kingSide ? path : path | (toBit >> 1);
+
+            if (!((pos().castling >> rightsShift) & (kingSide ? 0b10 : 0b01))) return false;
+            if (getPiece(kingSide ? kingStart + 3 : kingStart - 4) != (Us | Piece::ROOK)) return false;
+            if (occupancy & between) return false;
+            if (getAttackers(from, Them, occupancy)) return false;
+
+            while (path) {
+                if (getAttackers(__builtin_ctzll(path), Them, occupancy)) return false;
+                path &= path - 1;
+            }
+            return true;
+        }
 
-        if (kingLocations.size() == 0) return moveLines;
+        if (pieceType != Piece::PAWN) {
+            if (flags != Flag::NONE) return false;
+            return getPieceAttacks(pieceType, from, occupancy) & toBit;
+        }
 
-        int kingSquare = kingLocations[0];
+        if (flags == Flag::EN_PASSANT) {
+            return to == pos().enPassant && (Attacks::pawnAttacks(from, Us) & toBit) &&
+                   getPiece(to - dir) == (Them | Piece::PAWN);
+        }
 
-        // Pin line exists if there is a sliding piece of the opposite color after only a single friendly piece
-        for (int dirIndex = 0; dirIndex < 8; dirIndex++) {
-            int dir = Square::DIRECTIONS[dirIndex];
-            int blockingPieces = 0;
+        // Promotions and only promotions land on the last rank
+        if (move.isPromotion() != bool(toBit & promotionRank)) return false;
+        if (flags != Flag::NONE && !move.isPromotion()) return false;
 
-            // Go only the number of squares in the direction that actually exist
-            for (int i = 0; i < Square::MAX_SLIDING_DISTANCE[kingSquare][dirIndex]; i++) {
-                int destSquare = kingSquare + dir * (i + 1);
+        if (Attacks::pawnAttacks(from, Us) & toBit) return toBit & getColorBitboard(Them);
+        if (occupancy & toBit) return false;
+        if (to == from + dir) return true;
 
-                if (!Square::isOnBoard(destSquare)) {
-                    break;
-                }
+        return to == from + 2 * dir && (toBit & doublePushRank) && !(occupancy & (1ULL << (from + dir)));
+    }
 
-                int destPiece = getPiece(destSquare);
+    // Pseudo legal and doesn't leave our king attacked, in a few bitboard operations
+    bool isLegal(const Move move) {
+        if (!isPseudoLegal(move)) return false;
+        if (move.isCastle()) return true;
+
+        int us = pos().turn;
+        int from = move.getFrom();
+        int to = move.getTo();
+        uint64_t kingBitboard = getBitboard(us | Piece::KING);
+        if (kingBitboard == 0) return true;
+
+        // Look at the king from where it ends up, with the moved piece and anything it captured gone
+        int kingSquare = Piece::isType(getPiece(from), Piece::KING) ? to : __builtin_ctzll(kingBitboard);
+        uint64_t captured = 1ULL << to;
+        uint64_t occupancy = (getOccupancy() ^ (1ULL << from)) | captured;
+
+        if (move.isEnPassant()) {
+            captured = 1ULL << (to + (us == Piece::WHITE ? -8 : 8));
+            occupancy ^= captured;
+        }
 
-                if (destPiece == Piece::NONE) continue;
+        return !(getAttackers(kingSquare, Piece::getOppositeColor(us), occupancy) & ~captured);
+    }
 
-                if ((destPiece == Piece::getOppositeColor(kingColor | Piece::QUEEN)) ||
-                    (destPiece == Piece::getOppositeColor(kingColor | Piece::ROOK) && dirIndex < 4) ||
-                    (destPiece == Piece::getOppositeColor(kingColor | Piece::BISHOP) && dirIndex >= 4)) {
-                    if (blockingPieces == lineType) {
-                        moveLines.push_back(MoveLine(kingSquare, destSquare));
-                        break;
-                    }
-                } else {
-                    blockingPieces++;
-                }
+    // Every piece of attackerColor hitting the square, sliders see through pieces missing from occupancy
+    uint64_t getAttackers(int square, int attackerColor, uint64_t occupancy) {
+        return attackingPawnBitboard(square, attackerColor) | attackingKnightBitboard(square, attackerColor) |
+               attackingKingBitboard(square, attackerColor) | getSliderAttackers(square, attackerColor, occupancy);
+    }
 
-                if (blockingPieces > 1) break;
-            }
+    // Static exchange evaluation, the material the side to move comes out with if both sides keep recapturing on
+    // the target square with their least valuable attacker and either may stop. Sliders behind a capturer join in
+    // once it leaves, pins are ignored
+    int see(const Move move) {
+        if (move.isCastle()) return 0;
+
+        int from = move.getFrom();
+        int to = move.getTo();
+        int side = pos().turn;
+
+        uint64_t occupancy = getOccupancy();
+        uint64_t bishops = getBitboard(Piece::WHITE | Piece::BISHOP) | getBitboard(Piece::BLACK | Piece::BISHOP);
+        uint64_t rooks = getBitboard(Piece::WHITE | Piece::ROOK) | getBitboard(Piece::BLACK | Piece::ROOK);
+        uint64_t queens = getBitboard(Piece::WHITE | Piece::QUEEN) | getBitboard(Piece::BLACK | Piece::QUEEN);
+        bishops |= queens;
+        rooks |= queens;
+
+        int gain[32];
+        int depth = 0;
+        int onSquare = Piece::getPieceType(getPiece(from));  // The piece that would be captured next
+
+        gain[0] = Piece::SEE_VALUES[Piece::getPieceType(getPiece(to))];
+        if (move.isEnPassant()) {
+            gain[0] = Piece::SEE_VALUES[Piece::PAWN];
+            occupancy ^= 1ULL << (to + (side == Piece::WHITE ? -8 : 8));
+        }
+        if (move.isPromotion()) {
+            onSquare = move.getPromotionPiece();
+            gain[0] += Piece::SEE_VALUES[onSquare] - Piece::SEE_VALUES[Piece::PAWN];
         }
 
-        if (lineType == MoveLine::CHECK) {
-            for (int pos :
-                 BitBoard::getToggled(attackingPawnBitboard(kingSquare, Piece::getOppositeColor(kingColor)))) {
-                moveLines.push_back(MoveLine(pos, pos));
-            }
+        uint64_t fromBit = 1ULL << from;
+        uint64_t attackers = getAttackers(to, Piece::WHITE, occupancy) | getAttackers(to, Piece::BLACK, occupancy);
+
+        while (true) {
+            depth++;
+            gain[depth] = Piece::SEE_VALUES[onSquare] - gain[depth - 1];  // If the other side takes what's there
+
+            // The capturer leaves its square, uncovering any slider behind it
+            occupancy ^= fromBit;
+            attackers |= (Attacks::bishopAttacks(to, occupancy) & bishops) | (Attacks::rookAttacks(to, occupancy) & rooks);
+            attackers &= occupancy;
+
+            side = Piece::getOppositeColor(side);
 
-            for (int pos :
-                 BitBoard::getToggled(attackingKnightBitboard(kingSquare, Piece::getOppositeColor(kingColor)))) {
-                moveLines.push_back(MoveLine(pos, pos));
+            // Least valuable attacker of the side to recapture
+            fromBit = 0;
+            for (int pieceType = Piece::PAWN; pieceType <= Piece::KING; pieceType++) {
+                uint64_t candidates = attackers & getBitboard(side | pieceType);
+                if (candidates) {
+                    fromBit = candidates & -candidates;
+                    onSquare = pieceType;
+                    break;
+                }
             }
+
+            if (!fromBit) break;
         }
 
-        return moveLines;
+        while (--depth) gain[depth - 1] = -max(-gain[depth - 1], gain[depth]);
+
+        return gain[0];
     }
 
-    MoveLine getPinLine(const MoveLines& pinLines, int square) {
-        for (MoveLine pinLine : pinLines) {
-            if (pinLine.inLine(square)) return pinLine;
+    uint64_t getPieceAttacks(int pieceType, int square, uint64_t occupancy) {
+        switch (pieceType) {
+            case Piece::KNIGHT:
+                return Attacks::knightAttacks(square);
+            case Piece::BISHOP:
+                return Attacks::bishopAttacks(square, occupancy);
+            case Piece::ROOK:
+                return Attacks::rookAttacks(square, occupancy);
+            case Piece::QUEEN:
+                return Attacks::queenAttacks(square, occupancy);
+            case Piece::KING:
+                return Attacks::kingAttacks(square);
+            default:
+                throw invalid_argument("Invalid piece type in getPieceAttacks");
         }
-
-        return MoveLine();
     }
 
-    bool inValidMoveLines(const Move& candidateMove, const MoveLine& checkLine, const MoveLine& pinLine) {
-        // No check, not pinned
-        if (checkLine.isNull() && pinLine.isNull()) {
-            return true;
-        }
+    // Every square attacked by a color, sliders see through pieces missing from occupancy
+    uint64_t getAttackedSquares(int color, uint64_t occupancy) {
+        uint64_t attacks = BitBoard::pawnAttacks(getBitboard(color | Piece::PAWN), color);
+        attacks |= BitBoard::knightAttacks(getBitboard(color | Piece::KNIGHT));
+        attacks |= BitBoard::kingAttacks(getBitboard(color | Piece::KING));
 
-        // Move must block the check, not pinned
-        if (!checkLine.isNull() && pinLine.isNull() && checkLine.inLine(candidateMove.getTo())) {
-            return true;
-        }
+        uint64_t queens = getBitboard(color | Piece::QUEEN);
+        uint64_t bishops = getBitboard(color | Piece::BISHOP) | queens;
+        uint64_t rooks = getBitboard(color | Piece::ROOK) | queens;
 
-        // No check, Move must stay within pin
-        if (checkLine.isNull() && !pinLine.isNull() && pinLine.inLine(candidateMove.getTo())) {
-            return true;
+        while (bishops) {
+            attacks |= Attacks::bishopAttacks(__builtin_ctzll(bishops), occupancy);
+            bishops &= bishops - 1;
         }
 
-        // Check and pinned, must block check and stay in pin
-        if (!checkLine.isNull() && !pinLine.isNull() && pinLine.inLine(candidateMove.getTo()) &&
-            checkLine.inLine(candidateMove.getTo())) {
-            return true;
+        while (rooks) {
+            attacks |= Attacks::rookAttacks(__builtin_ctzll(rooks), occupancy);
+            rooks &= rooks - 1;
         }
 
-        return false;
+        return attacks;
     }
 
-    uint64_t attackingPawnBitboard(int square, int attackerColor) {
-        uint64_t squareBoard = 1ULL << square;
+    // Sliders of attackerColor that hit the square given the occupancy
+    uint64_t getSliderAttackers(int square, int attackerColor, uint64_t occupancy) {
+        uint64_t queens = getBitboard(attackerColor | Piece::QUEEN);
+
+        return (Attacks::rookAttacks(square, occupancy) & (getBitboard(attackerColor | Piece::ROOK) | queens)) |
+               (Attacks::bishopAttacks(square, occupancy) & (getBitboard(attackerColor | Piece::BISHOP) | queens));
+    }
 
-        uint64_t pawnAttacks = 0;
+    // Enemy pieces giving check to the king of kingColor
+    uint64_t getCheckers(int kingSquare, int kingColor) {
+        int enemyColor = Piece::getOppositeColor(kingColor);
 
-        if (attackerColor == Piece::WHITE) {
-            pawnAttacks |= (squareBoard & ~BitBoard::FILE_A) >> 9;  // left
-            pawnAttacks |= (squareBoard & ~BitBoard::FILE_H) >> 7;  // right
-        }
-        if (attackerColor == Piece::BLACK) {
-            pawnAttacks |= (squareBoard & ~BitBoard::FILE_H) << 9;  // right
-            pawnAttacks |= (squareBoard & ~BitBoard::FILE_A) << 7;  // left
+        return attackingPawnBitboard(kingSquare, enemyColor) | attackingKnightBitboard(kingSquare, enemyColor) |
+               getSliderAttackers(kingSquare, enemyColor, getOccupancy());
+    }
+
+    // Candidate pieces that are the only blocker between the king and a slider of sliderColor
+    // Our own candidates against their sliders are pins, against our sliders they are discovered checks
+    uint64_t getBlockers(int kingSquare, int sliderColor, uint64_t candidates) {
+        uint64_t occupancy = getOccupancy();
+
+        // Remove the first candidate on every ray and see which sliders appear
+        uint64_t blockers = Attacks::queenAttacks(kingSquare, occupancy) & candidates;
+        uint64_t pinners = getSliderAttackers(kingSquare, sliderColor, occupancy ^ blockers) &
+                           ~getSliderAttackers(kingSquare, sliderColor, occupancy);
+
+        uint64_t pinned = 0;
+        while (pinners) {
+            pinned |= Attacks::BETWEEN[kingSquare][__builtin_ctzll(pinners)] & candidates;
+            pinners &= pinners - 1;
         }
 
-        return pawnAttacks & getBitboard(attackerColor | Piece::PAWN);
+        return pinned;
     }
 
-    uint64_t attackingKnightBitboard(int square, int attackerColor) {
-        uint64_t piecePos = 1ULL << square;
-        uint64_t knightAttacks = 0;
+    stackvector<int, NUM_SQUARES> getPieceLocations(int piece) {
+        return BitBoard::getToggled(pos().bitboards[BitBoard::getBoardIndex(piece)]);
+    }
 
-        // Check if a knight is giving check
-        knightAttacks |= (piecePos & ~BitBoard::FILE_A) << 15;                       // 2 up, 1 left
-        knightAttacks |= (piecePos & ~(BitBoard::FILE_A | BitBoard::FILE_B)) << 6;   // 1 up, 2 left
-        knightAttacks |= (piecePos & ~(BitBoard::FILE_A | BitBoard::FILE_B)) >> 10;  // 1 down, 2 left
-        knightAttacks |= (piecePos & ~BitBoard::FILE_A) >> 17;                       // 2 up, 1 left
-        knightAttacks |= (piecePos & ~BitBoard::FILE_H) << 17;                       // 2 up, 1 left
-        knightAttacks |= (piecePos & ~(BitBoard::FILE_H | BitBoard::FILE_G)) << 10;  // 1 up, 2 left
-        knightAttacks |= (piecePos & ~(BitBoard::FILE_H | BitBoard::FILE_G)) >> 6;   // 1 down, 2 left
-        knightAttacks |= (piecePos & ~BitBoard::FILE_H) >> 15;                       // 2 up, 1 left
+    uint64_t attackingPawnBitboard(int square, int attackerColor) {
+        // Attacking pawns sit where a defending pawn on the square would capture
+        return Attacks::pawnAttacks(square, Piece::getOppositeColor(attackerColor)) &
+               getBitboard(attackerColor | Piece::PAWN);
+    }
+
+    uint64_t attackingKnightBitboard(int square, int attackerColor) {
+        return Attacks::knightAttacks(square) & getBitboard(attackerColor | Piece::KNIGHT);
+    }
 
-        return knightAttacks & getBitboard(attackerColor | Piece::KNIGHT);
+    uint64_t attackingKingBitboard(int square, int attackerColor) {
+        return Attacks::kingAttacks(square) & getBitboard(attackerColor | Piece::KING);
     }
 
     bool isAttackedByPawn(int square, int attackerColor) {
@@ -739,46 +894,18 @@ class Board {
 
     // Returns True if the current turn player is in check
     bool isCheck() {
-        for (const int kingSquare : getPieceLocations(m_turn | Piece::KING)) {
-            // Check if a pawn is giving check
-            if (isAttackedByPawn(kingSquare, getNextTurn())) {
-                return true;
-            }
-
-            if (isAttackedByKnight(kingSquare, getNextTurn())) {
-                return true;
-            }
+        uint64_t kingBitboard = getBitboard(pos().turn | Piece::KING);
+        if (kingBitboard == 0) return false;
 
-            // Check if a sliding piece is giving check
-            for (int dirIndex = 0; dirIndex < 8; dirIndex++) {
-                int dir = Square::DIRECTIONS[dirIndex];
+        int kingSquare = __builtin_ctzll(kingBitboard);
+        int enemyColor = getNextTurn();
 
-                // Go only the number of squares in the direction that actually exist
-                for (int i = 0; i < Square::MAX_SLIDING_DISTANCE[kingSquare][dirIndex]; i++) {
-                    int destSquare = kingSquare + dir * (i + 1);
-                    if (!Square::isOnBoard(destSquare)) {
-                        break;
-                    }
-
-                    int destPiece = getPiece(destSquare);
+        if (isAttackedByPawn(kingSquare, enemyColor)) return true;
+        if (isAttackedByKnight(kingSquare, enemyColor)) return true;
+        if (attackingKingBitboard(kingSquare, enemyColor)) return true;
 
-                    if (destPiece == Piece::NONE) continue;
-
-                    if (Piece::isColor(destPiece, m_turn))
-                        break;
-                    else if (Piece::isType(destPiece, Piece::KING) && i == 0)
-                        return true;
-                    else if (Piece::isType(destPiece, Piece::QUEEN))
-                        return true;
-                    else if (Piece::isType(destPiece, Piece::ROOK) && dirIndex < 4)
-                        return true;
-                    else if (Piece::isType(destPiece, Piece::BISHOP) && dirIndex >= 4)
-                        return true;
-                    else
-                        break;
-                }
-            }
-        }
+        // Check if a sliding piece is giving check
+        if (getSliderAttackers(kingSquare, enemyColor, getOccupancy())) return true;
 
         return false;
     }
@@ -797,223 +924,176 @@ class Board {
             return true;
         }
 
-        if (m_halfmove == 100) return true;
-
         return false;
     }
 
-    // Caller must make sure move is pseudo-legal
-    MoveDelta makeMove(const Move move) {
-        // Handle Basic Move Logic //
-        int movedPiece = getPiece(move.getFrom());
-        int capturedPiece = getPiece(move.getTo());
+    // Checkmate takes precedence, so only a draw if the side to move isn't mated
+    inline bool isFiftyMoveDraw() const { return pos().halfmove >= 100; }
 
-        MoveDelta delta =
-            MoveDelta(move.getFrom(), move.getTo(), capturedPiece, m_enPassant, m_halfmove, move.isPromotion(), move);
+    // True if the current position occurred at least count times before. Only positions with the same side to move
+    // since the last capture or pawn move can repeat, so the scan stops at the halfmove clock
+    bool isRepetition(int count) const {
+        size_t lookback = min<size_t>(pos().halfmove, m_ply);
+        uint64_t key = getHash();
 
-        if (movedPiece == Piece::NONE) {
-            throw invalid_argument("Cannot make move: " + move.toUci() + " No piece at the source square: " +
-                                   Square::toUci(move.getFrom()) + "\nBoard State:\n" + visualizeBoard());
-        }
-
-        setSquare(move.getTo(), movedPiece);
-        setSquare(move.getFrom(), Piece::NONE);
-
-        // Handle En-Passant
-        // If a pawn captures the enpassant square, its En-Passant (Assuming Pseudo Legal Move)
-        if (Piece::isType(movedPiece, Piece::PAWN) && move.getTo() == m_enPassant) {
-            // 5th, and 4th rank by zero index
-            if (Piece::isColor(movedPiece, Piece::WHITE)) {
-                delta.takenPiece = getPiece(move.getTo() - 8);
-                delta.takenPiecePos = move.getTo() - 8;
-
-                setSquare(move.getTo() - 8, Piece::NONE);
-            } else {
-                delta.takenPiece = getPiece(move.getTo() + 8);
-                delta.takenPiecePos = move.getTo() + 8;
-
-                setSquare(move.getTo() + 8, Piece::NONE);
-            }
-        }
-
-        // If a pawn jumps 2 squares then record the enpassant square
-        if (Piece::isType(movedPiece, Piece::PAWN) && abs(move.dy()) == 2) {
-            m_enPassant = Piece::isColor(movedPiece, Piece::WHITE) ? move.getFrom() + 8 : move.getFrom() - 8;
-        } else {
-            m_enPassant = -1;
-        }
-
-        // If the move has a promotion flag, change the end piece type
-        if (move.isPromotion()) {
-            setSquare(move.getTo(), m_turn | move.getPromotionPiece());
+        for (size_t back = 4; back <= lookback; back += 2) {
+            if (getKeyAtPly(m_ply - back) == key && --count == 0) return true;
         }
 
-        delta.originalCastlingRights = m_castling;
-
-        // Handle Castling Rights
-        int castleRightsMask = 0b1111;
-
-        // If the king moves, remove that colors rights
-        if (Piece::getPieceType(movedPiece) == Piece::KING) {
-            castleRightsMask = Piece::isColor(movedPiece, Piece::WHITE) ? 0b0011 : 0b1100;
-        }
-
-        // Rook moved
-        if (Piece::getPieceType(movedPiece) == Piece::ROOK) {
-            switch (move.getFrom()) {
-                case Square::A1:
-                    castleRightsMask = 0b1011;
-                    break;
-                case Square::H1:
-                    castleRightsMask = 0b0111;
-                    break;
-                case Square::A8:
-                    castleRightsMask = 0b1110;
-                    break;
-                case Square::H8:
-                    castleRightsMask = 0b1101;
-                    break;
-            }
-        }
-
-        // Rook captured
-        if (Piece::getPieceType(capturedPiece) == Piece::ROOK) {
-            switch (move.getTo()) {
-                case Square::A1:
-                    castleRightsMask = 0b1011;
-                    break;
-                case Square::H1:
-                    castleRightsMask = 0b0111;
-                    break;
-                case Square::A8:
-                    castleRightsMask = 0b1110;
-                    break;
-                case Square::H8:
-                    castleRightsMask = 0b1101;
-                    break;
-            }
-        }
-
-        // Handle Castle
-        if (movedPiece == (Piece::WHITE | Piece::KING) && move.dx() == 2) {
-            setSquare(Square::F1, getPiece(Square::H1));
-            setSquare(Square::H1, Piece::NONE);
-        } else if (movedPiece == (Piece::WHITE | Piece::KING) && move.dx() == -2) {
-            setSquare(Square::D1, getPiece(Square::A1));
-            setSquare(Square::A1, Piece::NONE);
-        } else if (movedPiece == (Piece::BLACK | Piece::KING) && move.dx() == 2) {
-            setSquare(Square::F8, getPiece(Square::H8));
-            setSquare(Square::H8, Piece::NONE);
-        } else if (movedPiece == (Piece::BLACK | Piece::KING) && move.dx() == -2) {
-            setSquare(Square::D8, getPiece(Square::A8));
-            setSquare(Square::A8, Piece::NONE);
-        }
-
-        m_castling &= castleRightsMask;
-
-        m_moveHistory.push(delta);
+        return false;
+    }
 
-        m_turn = getNextTurn();
+    // Builds a move from UCI, filling in the castle and en passant kinds that the string can't carry
+    Move parseMove(const string& uci) {
+        if (uci.length() != 4 && uci.length() != 5) throw invalid_argument("Invalid UCI move: " + uci);
+        Move move = Move(uci);
 
-        m_halfmove += 1;
-        if (capturedPiece != Piece::NONE || Piece::isType(movedPiece, Piece::PAWN)) m_halfmove = 0;
-        if (m_turn == Piece::BLACK) m_fullmove += 1;
+        int movedPiece = getPiece(move.getFrom());
 
-        m_moveStack.push_back(move);
+        if (Piece::isType(movedPiece, Piece::KING) && abs(move.dx()) == 2)
+            return Move(move.getFrom(), move.getTo(), Flag::CASTLE);
+        if (Piece::isType(movedPiece, Piece::PAWN) && move.getTo() == pos().enPassant)
+            return Move(move.getFrom(), move.getTo(), Flag::EN_PASSANT);
 
-        // Update Hash
+        return move;
+    }
 
-        m_positionHash.toggleTurn();
-        m_positionHash.toggleCastlingRights(delta.originalCastlingRights ^ m_castling);  // Toggle changed bits
+    // Caller must make sure move is pseudo-legal
+    void makeMove(const Move move) {
+        if (getTurn() == Piece::WHITE)
+            makeMove<Piece::WHITE>(move);
+        else
+            makeMove<Piece::BLACK>(move);
+    }
 
-        // Do nothing if the same
-        if (delta.originalEnPassant == m_enPassant) {
-        }
-        // New Enpassant made, (turn on new)
-        else if (delta.originalEnPassant == 1)
-            m_positionHash.toggleEnPassant(Square::file(m_enPassant));
-        // Enpassant Cleared, (turn off old)
-        else if (m_enPassant == -1)
-            m_positionHash.toggleEnPassant(Square::file(delta.originalEnPassant));
-        // Enpassant changed, (turn off old, turn on new)
-        else {
-            m_positionHash.toggleEnPassant(Square::file(delta.originalEnPassant));
-            m_positionHash.toggleEnPassant(Square::file(m_enPassant));
+    template <int Us>
+    void makeMove(const Move move) {
+        if (getPiece(move.getFrom()) == Piece::NONE) {
+            throw invalid_argument("Cannot make move: " + move.toUci() + " No piece at the source square: " +
+                                   Square::toUci(move.getFrom()) + "\nBoard State:\n" + visualizeBoard());
         }
 
-        return delta;
+        // Only grows when a game outlasts the reserved history, never inside a reserved search
+        if (m_ply + 1 == m_moves.size()) resizeHistory(m_moves.size() * 2);
+
+        m_moves[m_ply] = move;
+
+#ifdef COPY_MAKE
+        m_positions[m_ply + 1] = m_positions[m_ply];
+        m_ply++;
+        pos().makeMove<Us>(move);
+#else
+        BoardState& state = m_states[m_ply++];
+        state.castling = m_position.castling;
+        state.enPassant = m_position.enPassant;
+        state.halfmove = m_position.halfmove;
+        state.key = m_position.hash.get();
+        state.pawnKey = m_position.pawnHash.get();
+        state.materialKey = m_position.materialHash.get();
+        state.capturedPiece = m_position.makeMove<Us>(move);
+#endif
+
+        verifyKeys();
     }
 
     Move unmakeLastMove() {
-        m_moveStack.pop_back();
-
-        MoveDelta delta = m_moveHistory.top();
-
-        int fromSquare = delta.movedPiecePos;
-        int toSquare = delta.movedPieceEndPos;
-        int movedPiece = getPiece(toSquare);
+        return getTurn() == Piece::WHITE ? unmakeLastMove<Piece::BLACK>() : unmakeLastMove<Piece::WHITE>();
+    }
 
-        int promotionFlag = delta.promotion ? Flag::fromPiece(Piece::getPieceType(movedPiece)) : 0;
+    // Us is the side that made the move being taken back
+    template <int Us>
+    Move unmakeLastMove() {
+        if (m_ply == 0) throw logic_error("No move to unmake");
+
+        m_ply--;
+
+#ifndef COPY_MAKE
+        // Pieces go back without touching the hash, everything else comes from the saved state
+        const BoardState& state = m_states[m_ply];
+        m_position.unmakeMove<Us>(m_moves[m_ply], state.capturedPiece);
+        m_position.castling = state.castling;
+        m_position.enPassant = state.enPassant;
+        m_position.halfmove = state.halfmove;
+        m_position.hash.set(state.key);
+        m_position.pawnHash.set(state.pawnKey);
+        m_position.materialHash.set(state.materialKey);
+#endif
+
+        verifyKeys();
+        return m_moves[m_ply];
+    }
 
-        Move returnMove = Move(fromSquare, toSquare, promotionFlag);
+    // Hands the turn to the other side, the side to move must not be in check. Recorded as a null move in the history
+    void makeNullMove() {
+        if (m_ply + 1 == m_moves.size()) resizeHistory(m_moves.size() * 2);
+
+        m_moves[m_ply] = Move();
+
+#ifdef COPY_MAKE
+        m_positions[m_ply + 1] = m_positions[m_ply];
+        m_ply++;
+        pos().makeNullMove();
+#else
+        BoardState& state = m_states[m_ply++];
+        state.enPassant = m_position.enPassant;
+        state.halfmove = m_position.halfmove;
+        state.key = m_position.hash.get();
+        m_position.makeNullMove();
+#endif
+
+        verifyKeys();
+    }
 
-        // Unmake base move
-        setSquare(fromSquare, movedPiece);
-        setSquare(toSquare, Piece::NONE);
-        setSquare(delta.takenPiecePos, delta.takenPiece);
+    void unmakeNullMove() {
+        if (m_ply == 0) throw logic_error("No move to unmake");
 
-        // Undo Promotion
-        if (returnMove.isPromotion()) {
-            setSquare(fromSquare, Piece::getColor(movedPiece) | Piece::PAWN);
-        }
+        m_ply--;
 
-        // Unmake the castling move
-        int dx = Square::file(toSquare) - Square::file(fromSquare);
+#ifndef COPY_MAKE
+        const BoardState& state = m_states[m_ply];
+        m_position.turn = Piece::getOppositeColor(m_position.turn);
+        m_position.enPassant = state.enPassant;
+        m_position.halfmove = state.halfmove;
+        m_position.hash.set(state.key);
+#endif
 
-        if (movedPiece == (Piece::WHITE | Piece::KING) && dx == 2) {
-            setSquare(Square::H1, getPiece(Square::F1));
-            setSquare(Square::F1, Piece::NONE);
-        } else if (movedPiece == (Piece::WHITE | Piece::KING) && dx == -2) {
-            setSquare(Square::A1, getPiece(Square::D1));
-            setSquare(Square::D1, Piece::NONE);
-        } else if (movedPiece == (Piece::BLACK | Piece::KING) && dx == 2) {
-            setSquare(Square::H8, getPiece(Square::F8));
-            setSquare(Square::F8, Piece::NONE);
-        } else if (movedPiece == (Piece::BLACK | Piece::KING) && dx == -2) {
-            setSquare(Square::A8, getPiece(Square::D8));
-            setSquare(Square::D8, Piece::NONE);
-        }
+        verifyKeys();
+    }
 
-        // Update hash
-        m_positionHash.toggleTurn();
-        m_positionHash.toggleCastlingRights(m_castling ^ delta.originalCastlingRights);
+    // Build with VERIFY_KEYS to check every incremental key against one computed from scratch after each move
+    inline void verifyKeys() const {
+#ifdef VERIFY_KEYS
+        if (pos().hash.get() != pos().computeKey()) throw logic_error("Zobrist key out of sync\n" + getFen());
+        if (pos().pawnHash.get() != pos().computePawnKey()) throw logic_error("Pawn key out of sync\n" + getFen());
+        if (pos().materialHash.get() != pos().computeMaterialKey())
+            throw logic_error("Material key out of sync\n" + getFen());
+#endif
+    }
 
-        // Do nothing if the same
-        if (delta.originalEnPassant == m_enPassant) {
-        }
-        // New Enpassant made, (turn on new)
-        else if (delta.originalEnPassant == 1)
-            m_positionHash.toggleEnPassant(Square::file(m_enPassant));
-        // Enpassant Cleared, (turn off old)
-        else if (m_enPassant == -1)
-            m_positionHash.toggleEnPassant(Square::file(delta.originalEnPassant));
-        // Enpassant changed, (turn off old, turn on new)
-        else {
-            m_positionHash.toggleEnPassant(Square::file(delta.originalEnPassant));
-            m_positionHash.toggleEnPassant(Square::file(m_enPassant));
-        }
+    inline uint64_t getHash() const { return pos().hash.get(); }
 
-        // update member state
-        m_turn = getNextTurn();
-        m_castling = delta.originalCastlingRights;
-        m_enPassant = delta.originalEnPassant;
-        m_halfmove = delta.originalHalfmove;
-        if (m_turn == Piece::WHITE) m_fullmove -= 1;
+    // Key of an earlier position in the game, ply must not be past the current one
+    inline uint64_t getKeyAtPly(size_t ply) const {
+#ifdef COPY_MAKE
+        return m_positions[ply].hash.get();
+#else
+        return ply == m_ply ? getHash() : m_states[ply].key;
+#endif
+    }
+    inline uint64_t getPawnKey() const { return pos().pawnHash.get(); }
+    inline uint64_t getMaterialKey() const { return pos().materialHash.get(); }
 
-        m_moveHistory.pop();
+    // Makes sure the next plies can be made without growing the history, call before searching
+    void reserveHistory(int plies) {
+        if (m_ply + plies >= m_moves.size()) resizeHistory(m_ply + plies + 1);
+    }
 
-        return returnMove;
+    // Anything but pawns and the king, without it passing can be the only thing that doesn't lose (zugzwang)
+    inline bool hasNonPawnMaterial(int color) {
+        return getColorBitboard(color) & ~getBitboard(color | Piece::PAWN) & ~getBitboard(color | Piece::KING);
     }
 
-    uint64_t getBitboard(int piece) { return m_bitboards[BitBoard::getBoardIndex(piece)]; }
+    uint64_t getBitboard(int piece) { return pos().bitboards[BitBoard::getBoardIndex(piece)]; }
+    inline uint64_t getColorBitboard(int color) { return pos().bitboards[BitBoard::getColorIndex(color)]; }
+    inline uint64_t getOccupancy() { return pos().bitboards[BitBoard::ALL_PIECES]; }
 };
@@ -0,0 +1,259 @@
+// Board consistency checks
+// Build: g++ -O3 -o board_check board_check.cpp
+// Usage: board_check [games] [seed]
+//
+// Checks that a FEN which doesn't parse is rejected without touching the current position, then plays random games
+// and at every position tests all 65536 move codes with isLegal and isPseudoLegal against legal move generation, and
+// every capture's SEE against playing the exchange out on the board. Exits with 1 if any check fails.
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+#include "engine.hpp"
+
+using namespace std;
+
+int failures = 0;
+
+void check(bool passed, const string& what) {
+    if (!passed) failures++;
+    cout << "    " << (passed ? "ok  " : "FAIL") << " " << what << endl;
+}
+
+// Neither the board nor a game in progress should change when setting up a bad FEN
+void checkBadFens() {
+    const vector<string> badFens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNX w KQkq - 0 1",  // Unknown piece after most of the board is set
+        "8/8/8/8/8/8/8/8/K7 w - - 0 1",                               // Nine ranks
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBN w KQkq - 0 1",    // Short rank
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNRR w KQkq - 0 1",  // Long rank
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQ1BNR w kq - 0 1",     // No white king
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1",   // Bad side to move
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq",         // Missing fields
+        "4k3/8/8/8/8/8/8/3K3R w K - 0 1",                             // Castling right without the king at home
+        "4k2r/8/8/8/8/8/8/4K3 b q - 0 1",                             // Castling right without the rook at home
+        "4k3/8/8/4P3/8/8/8/4K3 w - d6 0 1",                           // En passant without the pawn that moved
+        "4k3/8/8/3pP3/8/8/8/4K3 b - d6 0 1",                          // En passant on the wrong side's rank
+        "4k3/8/8/8/8/8/8/4K3 w - a1 0 1",                             // En passant on the first rank
+        "4k3/8/8/8/8/8/8/4K3 b - h8 0 1",                             // En passant on the last rank
+    };
+
+    cout << "Bad FENs" << endl;
+
+    stringstream nullStream;
+    Board board(nullStream);
+    board.makeMove(board.parseMove("e2e4"));
+
+    string fen = board.getFen();
+    uint64_t key = board.getHash();
+    uint64_t pawnKey = board.getPawnKey();
+    uint64_t materialKey = board.getMaterialKey();
+
+    Engine engine(nullStream, nullStream);
+    engine.setPosition(START_FEN, {"e2e4"});
+
+    for (const string& badFen : badFens) {
+        bool rejected = false;
+        try {
+            board.setBoard(badFen);
+        } catch (const invalid_argument&) {
+            rejected = true;
+        }
+
+        check(rejected && board.getFen() == fen && board.getHash() == key && board.getPawnKey() == pawnKey &&
+                  board.getMaterialKey() == materialKey,
+              "board kept " + badFen);
+
+        rejected = false;
+        try {
+            engine.setPosition(badFen, {});
+        } catch (const invalid_argument&) {
+            rejected = true;
+        }
+
+        check(rejected && engine.getFen() == fen, "game kept " + badFen);
+    }
+
+    // The history is intact, so the move can still be taken back and the game extended
+    board.unmakeLastMove();
+    Board startBoard(nullStream);
+    check(board.getFen() == startBoard.getFen() && board.getHash() == startBoard.getHash(), "board history kept");
+
+    engine.setPosition(START_FEN, {"e2e4", "e7e5"});
+    board.makeMove(board.parseMove("e2e4"));
+    board.makeMove(board.parseMove("e7e5"));
+    check(engine.getFen() == board.getFen(), "game history kept");
+}
+
+const vector<string> FENS = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+};
+
+#define RANDOM_GAME_LENGTH 60
+
+// Random games from each FEN, every position visited goes to visit
+template <typename Visit>
+void playRandomGames(Board& board, int games, mt19937& rng, Visit visit) {
+    for (int game = 0; game < games; game++) {
+        board.setBoard(FENS[game % FENS.size()]);
+
+        for (int ply = 0; ply < RANDOM_GAME_LENGTH; ply++) {
+            MoveList moves;
+            board.generateMoves<GenType::LEGAL>(moves);
+            if (moves.empty()) break;
+
+            visit(moves);
+            board.makeMove(moves[rng() % moves.size()]);
+        }
+    }
+}
+
+// isLegal has to accept exactly the generated moves. isPseudoLegal has to accept those too, and anything else it
+// accepts has to leave the mover's king attacked once made
+void checkLegality(int games, mt19937& rng) {
+    cout << "Legality" << endl;
+
+    stringstream nullStream;
+    Board board(nullStream);
+    uint64_t positions = 0;
+    uint64_t mismatches = 0;
+    vector<bool> generated(1 << 16);
+
+    playRandomGames(board, games, rng, [&](const MoveList& moves) {
+        positions++;
+        fill(generated.begin(), generated.end(), false);
+        for (Move move : moves) generated[move.getData()] = true;
+
+        int us = board.getTurn();
+        uint64_t key = board.getHash();
+
+        for (int data = 0; data < 1 << 16; data++) {
+            Move move = Move::fromData(data);
+            bool legal = board.isLegal(move);
+            bool pseudoLegal = board.isPseudoLegal(move);
+            bool passed = legal == generated[data] && (pseudoLegal || !legal);
+
+            if (passed && pseudoLegal && !legal) {
+                board.makeMove(move);
+                uint64_t king = board.getBitboard(us | Piece::KING);
+                passed = board.getAttackers(__builtin_ctzll(king), board.getTurn(), board.getOccupancy()) != 0;
+                board.unmakeLastMove();
+                passed = passed && board.getHash() == key;
+            }
+
+            if (!passed && mismatches++ < 10) {
+                cout << "    " << board.getFen() << " " << move.toUci() << " flags " << move.getFlags() << " legal "
+                     << legal << " pseudo-legal " << pseudoLegal << " generated " << generated[data] << endl;
+            }
+        }
+    });
+
+    check(mismatches == 0, to_string(positions) + " positions, " + to_string(mismatches) + " mismatched moves");
+}
+
+// What the side to move gets from capturing on square with its least valuable attacker, either side may stop
+int playExchange(Board& board, int square) {
+    int us = board.getTurn();
+    uint64_t attackers = board.getAttackers(square, us, board.getOccupancy());
+    if (!attackers) return 0;
+
+    int from = -1;
+    for (int pieceType = Piece::PAWN; from == -1; pieceType++) {
+        uint64_t candidates = attackers & board.getBitboard(us | pieceType);
+        if (candidates) from = __builtin_ctzll(candidates);
+    }
+
+    int captured = Piece::SEE_VALUES[Piece::getPieceType(board.getPiece(square))];
+    board.makeMove(Move(from, square));
+    int value = captured - playExchange(board, square);
+    board.unmakeLastMove();
+
+    return max(0, value);
+}
+
+// Slow SEE from making the captures, pins are ignored like Board::see does
+int referenceSee(Board& board, Move move) {
+    int captured = move.isEnPassant() ? Piece::SEE_VALUES[Piece::PAWN]
+                                      : Piece::SEE_VALUES[Piece::getPieceType(board.getPiece(move.getTo()))];
+
+    board.makeMove(move);
+    int value = captured - playExchange(board, move.getTo());
+    board.unmakeLastMove();
+
+    return value;
+}
+
+// Hand worked exchanges, then every capture of the random games against referenceSee. Captures on the first and last
+// rank are left to the hand worked ones since a recapturing pawn would promote
+void checkSee(int games, mt19937& rng) {
+    struct SeeCase {
+        string fen;
+        string move;
+        int value;
+    };
+
+    const vector<SeeCase> cases = {
+        {"1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5", 100},
+        {"1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5", -200},  // Queens x-ray on both sides
+        {"4k3/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7b8q", 800},
+        {"r3k3/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7b8q", -100},
+        {"r3k3/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7a8q", 1300},
+        {"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 100},
+        {"4k3/2p5/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 0},
+    };
+
+    cout << "SEE" << endl;
+
+    stringstream nullStream;
+    Board board(nullStream);
+
+    for (const SeeCase& seeCase : cases) {
+        board.setBoard(seeCase.fen);
+        int value = board.see(board.parseMove(seeCase.move));
+        check(value == seeCase.value, seeCase.fen + " " + seeCase.move + " " + to_string(value));
+    }
+
+    uint64_t captures = 0;
+    uint64_t mismatches = 0;
+
+    playRandomGames(board, games, rng, [&](const MoveList& moves) {
+        for (Move move : moves) {
+            bool capture = board.getPiece(move.getTo()) != Piece::NONE || move.isEnPassant();
+            int rank = Square::rank(move.getTo());
+            if (!capture || rank == 0 || rank == 7) continue;
+
+            captures++;
+            int value = board.see(move);
+            int expected = referenceSee(board, move);
+
+            if (value != expected && mismatches++ < 10) {
+                cout << "    " << board.getFen() << " " << move.toUci() << " see " << value << " expected " << expected
+                     << endl;
+            }
+        }
+    });
+
+    check(mismatches == 0, to_string(captures) + " captures, " + to_string(mismatches) + " mismatched");
+}
+
+int main(int argc, char* argv[]) {
+    int games = argc > 1 ? stoi(argv[1]) : 240;
+    mt19937 rng(argc > 2 ? stoi(argv[2]) : 1);
+
+    checkBadFens();
+    checkLegality(games, rng);
+    checkSee(games, rng);
+
+    cout << "\n" << (failures ? to_string(failures) + " FAILED" : "All passed") << endl;
+    return failures ? 1 : 0;
+}
@@ -2,6 +2,7 @@
 #include <cctype>
 #include <fstream>
 #include <iostream>
+#include <new>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -32,6 +33,15 @@ class EngineInterface {
     void uci() {
         cout << "id name Moulik's Engine\n";
         cout << "id author Moulik\n";
+        cout << "option name Hash type spin default " << DEFAULT_HASH_MB << " min 1 max 65536\n";
+        cout << "option name PerftHash type spin default 0 min 0 max 65536\n";
+        cout << "option name Threads type spin default 1 min 1 max 256\n";
+        cout << "option name PVS type check default true\n";
+        cout << "option name AspirationWindows type check default true\n";
+        cout << "option name NullMove type check default true\n";
+        cout << "option name ReverseFutility type check default true\n";
+        cout << "option name LMR type check default true\n";
+        cout << "option name LMP type check default true\n";
         cout << "uciok\n";
     }
 
@@ -39,25 +49,77 @@ class EngineInterface {
 
     void ucinewgame() {
         m_engine.newGame();
+        m_engine.clearHash();
         cout << "New game initialized.\n";
     }
 
+    // position (startpos | fen <fen>) [moves <move1> ... <movei>]
     void position(const vector<string>& args) {
         cout << "Set position called with args: " << vecToString(args) << "\n";
-        if (args[0] == "startpos") {
-            m_engine.newGame();
+        if (args.empty()) {
+            cout << "position called with no args. Useage: position (startpos | fen <fen>) [moves <moves>]\n";
+            return;
+        }
 
-            for (size_t i = 1; i < args.size(); i++) {
-                m_engine.makeMove(Move(args[i]));
+        auto movesIt = find(args.begin(), args.end(), "moves");
+        vector<string> moves = movesIt == args.end() ? vector<string>() : vector<string>(movesIt + 1, args.end());
+
+        // A bad FEN or move stops at the last good position instead of taking the engine down
+        try {
+            if (args[0] == "startpos") {
+                m_engine.setPosition(START_FEN, moves);
+            } else if (args[0] == "fen") {
+                // FEN fields run up to the moves keyword
+                string fen = trim(vecToString(args, true, 1, movesIt - args.begin()));
+                m_engine.setPosition(fen, moves);
+            } else {
+                cout << "Unknown position command: " << args[0] << "\n";
             }
+        } catch (const exception& e) {
+            cout << "Invalid position: " << e.what() << "\n";
+        }
+    }
 
-        } else if (args[0] == "fen") {
-            // Combine the rest of the args into a single string
+    // setoption name <id> value <x>
+    void setoption(const vector<string>& args) {
+        auto nameIt = find(args.begin(), args.end(), "name");
+        auto valueIt = find(args.begin(), args.end(), "value");
 
-            string fen = vecToString(args, true, 1);
-            m_engine.newGame(fen);
-        } else {
-            cout << "Unknown position command: " << args[0] << "\n";
+        if (nameIt == args.end() || valueIt == args.end() || nameIt > valueIt) {
+            cout << "setoption called with bad args. Useage: setoption name <id> value <x>" << endl;
+            return;
+        }
+
+        string name = vecToString(vector<string>(nameIt + 1, valueIt), true);
+        string value = vecToString(vector<string>(valueIt + 1, args.end()), true);
+
+        // Tables are only replaced once the new ones are allocated, so running out of memory keeps the old setting
+        try {
+            if (name == "Hash") {
+                m_engine.setHashSize(stoi(value));
+            } else if (name == "PerftHash") {
+                m_engine.setPerftHashSize(stoi(value));
+            } else if (name == "Threads") {
+                m_engine.setThreads(stoi(value));
+            } else if (name == "PVS") {
+                m_engine.getSearchOptions().pvs = value == "true";
+            } else if (name == "AspirationWindows") {
+                m_engine.getSearchOptions().aspirationWindows = value == "true";
+            } else if (name == "NullMove") {
+                m_engine.getSearchOptions().nullMove = value == "true";
+            } else if (name == "ReverseFutility") {
+                m_engine.getSearchOptions().reverseFutility = value == "true";
+            } else if (name == "LMR") {
+                m_engine.getSearchOptions().lateMoveReductions = value == "true";
+            } else if (name == "LMP") {
+                m_engine.getSearchOptions().lateMovePruning = value == "true";
+            } else {
+                cout << "Unknown option: " << name << "\n";
+            }
+        } catch (const bad_alloc&) {
+            cout << "Could not allocate memory for " << name << " " << value << ", keeping the current setting\n";
+        } catch (const exception&) {
+            cout << "Invalid value for " << name << ": " << value << "\n";
         }
     }
 
@@ -95,6 +157,11 @@ class EngineInterface {
         cout << m_engine.perft(depth, multiDepth) << endl;
     }
 
+    void benchfen(const vector<string>& args) {
+        int iterations = args.empty() ? 1000000 : stoi(args[0]);
+        cout << m_engine.benchFen(iterations);
+    }
+
     void getfen() { cout << m_engine.getFen() << "\n"; }
 
     void getmoves() {
@@ -145,6 +212,20 @@ class EngineInterface {
         cout << Piece::toChar(m_engine.getPiece(bestMove.bestMove.getFrom())) << " " << bestMove.eval << endl;
     }
 
+    // see <move>, material won by the exchange the move starts
+    void see(const vector<string>& args) {
+        if (args.empty()) {
+            cout << "see called with no args. Useage: see <move>" << endl;
+            return;
+        }
+
+        try {
+            cout << m_engine.see(args[0]) << endl;
+        } catch (const invalid_argument& e) {
+            cout << e.what() << endl;
+        }
+    }
+
     void getgamewinner() { cout << m_engine.getGameWinner() << endl; }
 
     // Stub for the 'stop' command
@@ -184,10 +265,14 @@ class EngineInterface {
                 isready();
             } else if (command == "ucinewgame") {
                 ucinewgame();
+            } else if (command == "setoption") {
+                setoption(args);
             } else if (command == "position") {
                 position(args);
             } else if (command == "go") {
                 go(args);
+            } else if (command == "benchfen") {
+                benchfen(args);
             } else if (command == "getfen") {
                 getfen();
             } else if (command == "d") {
@@ -198,6 +283,8 @@ class EngineInterface {
                 getbestmove(args);
             } else if (command == "getbestpiece") {
                 getbestpiece(args);
+            } else if (command == "see") {
+                see(args);
             } else if (command == "getgamewinner") {
                 getgamewinner();
             } else if (command == "stop") {
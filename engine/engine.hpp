@@ -2,315 +2,425 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <iomanip>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include "board.hpp"
-#include "evaluation.hpp"
 #include "move.hpp"
+#include "perftTable.hpp"
 #include "piece.hpp"
+#include "searchWorker.hpp"
 #include "square.hpp"
+#include "transpositionTable.hpp"
 
-#define NEG_INF -1000000  // Close enough for all intents and purposes
-#define POS_INF 1000000
+#define DEFAULT_HASH_MB 16
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
 
 // #define
 
 using namespace std;
 using namespace std::chrono_literals;
 
-struct MoveEval {
-    int eval;
-    Move bestMove;
-
-    MoveEval() : eval(NEG_INF), bestMove(Move(0, 0)) {}
-    MoveEval(int eval, Move bestMove) : eval(eval), bestMove(bestMove) {}
-};
-
-struct MoveScore {
-    int score;
+// A root move, or a root move and reply, for one perft thread to count
+struct PerftWork {
     Move move;
+    Move reply;  // Null unless the root was split at the second ply
+    uint64_t nodes;
+};
 
-    bool operator<(const MoveScore& other) const { return score < other.score; }
-    bool operator>(const MoveScore& other) const { return score > other.score; }
+// Legal moves and game state of one position, so back to back UI queries only generate once
+struct PositionInfo {
+    bool valid = false;
+    uint64_t key;
+    MoveList moves;
+    bool isCheck;
 };
 
 class Engine {
    private:
     Board m_board;
-    ostream& m_outputStream;  // Reference to the output stream
+    TranspositionTable m_transpositionTable;
+    PositionInfo m_positionInfo;  // Invalidated whenever the game moves on
+    vector<PerftTable> m_perftTables = vector<PerftTable>(1);  // One per perft thread
+    int m_perftHashSize = 0;
+    string m_gameFen;            // Start of the current game
+    vector<string> m_gameMoves;  // Moves played from m_gameFen as they were given
+    ostream& m_outputStream;     // Reference to the output stream
     ostream& m_debugStream;
 
-    chrono::steady_clock::time_point m_searchEnd;
-    MoveEval m_lastBestMove;
+    int m_threads = 1;
+    SearchOptions m_searchOptions;
+    atomic<bool> m_stop;  // Raised when the main search thread is done, helpers stop with it
 
     // Debug
-    int m_positionsSearched = 0;
+    uint64_t m_positionsSearched = 0;  // Over all threads of the last search
 
    public:
     // Constructor accepting a stream
     Engine(ostream& stream, ostream& debugStream)
-        : m_board(debugStream), m_outputStream(stream), m_debugStream(debugStream) {}
+        : m_board(debugStream), m_outputStream(stream), m_debugStream(debugStream) {
+        m_transpositionTable.resize(DEFAULT_HASH_MB);
+    }
 
-    void newGame() { newGame("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"); }
+    void newGame() { newGame(START_FEN); }
     void newGame(string fen) {
+        // Throws before anything changes if the FEN doesn't parse, the current game stays as it was
         m_board.setBoard(fen);
+        m_gameFen = fen;
+        m_gameMoves.clear();
+        m_positionInfo.valid = false;
         // m_debugStream << m_board.visualizeBoard() << endl;
     }
 
-    void makeMove(Move move) {
+    void makeMove(Move move) { makeMove(move, move.toUci()); }
+    // Input from the GUI is checked before it touches the board
+    void makeMove(const string& uci) {
+        Move move = m_board.parseMove(uci);
+        if (!m_board.isLegal(move)) throw invalid_argument("Illegal move: " + uci);
+
+        makeMove(move, uci);
+    }
+
+    // Sets up fen and plays moves from it. If it's the same start as the current game only the moves after the
+    // common part are taken back or played, so a game that grows by a move each request costs one move
+    void setPosition(const string& fen, const vector<string>& moves) {
+        if (fen != m_gameFen) newGame(fen);
+
+        size_t common = 0;
+        while (common < m_gameMoves.size() && common < moves.size() && m_gameMoves[common] == moves[common]) common++;
+
+        while (m_gameMoves.size() > common) {
+            m_board.unmakeLastMove();
+            m_gameMoves.pop_back();
+            m_positionInfo.valid = false;
+        }
+
+        for (size_t i = common; i < moves.size(); i++) makeMove(moves[i]);
+    }
+
+    void makeMove(Move move, const string& uci) {
         m_board.makeMove(move);
+        m_gameMoves.push_back(uci);
+        m_positionInfo.valid = false;
         // m_debugStream << m_board.visualizeBoard() << endl;
     }
 
     string showBoard() { return m_board.visualizeBoard(); }
 
+    // Lazy SMP, every thread runs its own iterative deepening on its own board and they share only the hash table
     MoveEval moveSearch(int searchDepth, int maxSearchTimeMs) {
-        m_debugStream << "Static Evaluation: " << evaluate() << endl;
-        m_debugStream << "Is Check: " << m_board.isCheck() << endl;
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        chrono::steady_clock::time_point searchEnd = begin + chrono::milliseconds(maxSearchTimeMs);
+
+        m_stop = false;
+        m_transpositionTable.newSearch();
+
+        vector<SearchWorker> workers;
+        workers.reserve(m_threads);
+        for (int i = 0; i < m_threads; i++) workers.emplace_back(m_board, m_transpositionTable, m_searchOptions, m_stop, searchEnd, i);
+
+        m_debugStream << "Static Evaluation: " << workers[0].evaluate() << endl;
+        m_debugStream << "Is Check: " << getPositionInfo().isCheck << endl;
         // m_debugStream << "Is Checkmate: " << m_board.isCheckmate() << endl;
-        m_debugStream << "Total Moves: " << m_board.generateLegalMoves().size() << endl;
+        m_debugStream << "Total Moves: " << getPositionInfo().moves.size() << endl;
         // m_debugStream << "Legal Moves: " << arrToString(Move::getUciArr(m_board.generateLegalMoves())) << endl;
         m_debugStream << m_board.visualizeBoard() << endl;
 
-        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        vector<thread> helpers;
+        for (int i = 1; i < m_threads; i++)
+            helpers.emplace_back([&workers, i, searchDepth]() { workers[i].iterativeDeepening(searchDepth); });
 
-        m_searchEnd = begin + chrono::milliseconds(maxSearchTimeMs);
-        m_lastBestMove = MoveEval();
-        m_positionsSearched = 0;
+        workers[0].iterativeDeepening(searchDepth);
+        m_stop = true;
 
-        int searchDepthReached = 0;
+        for (thread& helper : helpers) helper.join();
 
-        for (int i = 1; i <= searchDepth; i++) {
-            MoveEval searchResult = search(i, i);
-            if (isSearchCanceled()) break;
+        // The deepest finished iteration wins, the main thread's on a tie
+        const SearchWorker* best = &workers[0];
+        m_positionsSearched = 0;
 
-            m_lastBestMove = searchResult;
-            searchDepthReached = i;
+        for (const SearchWorker& worker : workers) {
+            m_positionsSearched += worker.getPositionsSearched();
+            if (worker.getDepthReached() > best->getDepthReached()) best = &worker;
         }
 
+        MoveEval result = best->getBestMove();
+
         chrono::steady_clock::time_point end = chrono::steady_clock::now();
-        m_lastBestMove.eval = m_lastBestMove.eval * (m_board.getTurn() == Piece::WHITE ? 1 : -1);
+        int64_t timeMs = chrono::duration_cast<chrono::milliseconds>(end - begin).count();
+        result.eval = result.eval * (m_board.getTurn() == Piece::WHITE ? 1 : -1);
 
         // m_debugStream << m_board.visualizeBoard() << endl;
-        m_debugStream << "\nSearch Time: " << chrono::duration_cast<chrono::milliseconds>(end - begin).count() << "ms"
-                      << endl;
-        m_debugStream << "Depth: " << searchDepthReached << endl;
+        m_debugStream << "\nDepth  Eval     Nodes  Time(ms)  Re-searched/Null window  Aspiration re-searches"
+                      << "  Null move/Reverse futility cutoffs  Re-searched/Reduced  Pruned" << endl;
+        for (const DepthStats& stats : workers[0].getDepthStats()) {
+            m_debugStream << setw(5) << stats.depth << setw(6) << stats.eval << setw(10) << stats.positionsSearched
+                          << setw(10) << stats.timeMs << setw(13) << stats.reSearches << "/" << setw(11) << left
+                          << stats.nullWindowSearches << right << setw(24) << stats.aspirationReSearches << setw(19)
+                          << stats.nullMoveCutoffs << "/" << setw(17) << left << stats.reverseFutilityCutoffs << right
+                          << setw(11) << stats.reducedReSearches << "/" << setw(9) << left << stats.reducedSearches
+                          << right << setw(6) << stats.lateMovesPruned << endl;
+        }
+
+        m_debugStream << "\nSearch Time: " << timeMs << "ms" << endl;
+        m_debugStream << "Threads: " << m_threads << endl;
+        m_debugStream << "Depth: " << best->getDepthReached() << endl;
         m_debugStream << "Positions Searched: " << m_positionsSearched << endl;
-        m_debugStream << "Evaluation: " << m_lastBestMove.eval << endl;
-        m_debugStream << "Best Move: " << m_lastBestMove.bestMove.toUci() << endl;
+        m_debugStream << "NPS: " << m_positionsSearched * 1000 / max<int64_t>(timeMs, 1) << endl;
+        m_debugStream << "Hashfull: " << m_transpositionTable.hashfull() << endl;
+        m_debugStream << "Evaluation: " << result.eval << endl;
+        m_debugStream << "Best Move: " << result.bestMove.toUci() << endl;
         // m_debugStream << "Best Line: " << arrToString(Move::getUciArr(principalVariation));
-        m_debugStream << "\nEval: " << m_lastBestMove.eval << endl << endl << endl;
+        m_debugStream << "\nEval: " << result.eval << endl << endl << endl;
 
         m_debugStream.flush();
 
-        return m_lastBestMove;
+        return result;
     }
 
-    inline bool isSearchCanceled() {
-        return m_positionsSearched % 957 == 0 && chrono::steady_clock::now() > m_searchEnd - 3ms;
+    MoveEval getBestMove(int searchDepth, int maxSearchTimeMs = POS_INF) {
+        return moveSearch(searchDepth, maxSearchTimeMs);
+        // return MoveEval(0, Move(0, 1));
     }
 
-    MoveEval search(int depth, int searchDepth, int alpha = NEG_INF, int beta = POS_INF) {
-        int ply = searchDepth - depth + 1;
-        if (depth <= 0) {
-            return MoveEval(searchCaptures(alpha, beta), Move(0, 0));
-        }
+    int getPiece(int square) { return m_board.getPiece(square); }
 
-        if (isSearchCanceled()) {
-            return MoveEval(POS_INF, Move(0, 0));  // This move will never be picked
-        }
+    uint64_t getPositionsSearched() const { return m_positionsSearched; }
 
-        stackvector<Move, MAX_MOVES> moves = m_board.generateLegalMoves();
+    // Exchange value of a move in the current position, for debugging SEE
+    int see(const string& uci) {
+        Move move = m_board.parseMove(uci);
+        if (!m_board.isPseudoLegal(move)) throw invalid_argument("Illegal move: " + uci);
 
-        if (moves.empty()) {
-            if (m_board.isCheck()) return MoveEval(NEG_INF + ply, Move(0, 0));
-            return MoveEval(0, Move(0, 0));
-        }
+        return m_board.see(move);
+    }
 
-        orderMoves(moves, depth == searchDepth);
+    string getFen() const { return m_board.getFen(); }
 
-        MoveEval bestSoFar = MoveEval(NEG_INF, Move(0, 0));
-        for (Move move : moves) {
-            m_board.makeMove(move);
-            MoveEval res = search(depth - 1, searchDepth, -beta, -alpha);
-            res.eval = -res.eval;  // Negamax flip
-            m_board.unmakeLastMove();
+    string perft(int depth, bool multiDepth = false) {
+        stringstream output;
 
-            if (res.eval > bestSoFar.eval) {
-                bestSoFar.eval = res.eval;
-                bestSoFar.bestMove = move;
+        output << "\n";
+
+        if (!multiDepth) {
+            uint64_t val = perftDivide(depth, output);
+            output << "\nMoves searched: " << val << endl;
+
+        } else {
+            stringstream nullStream;
+            for (int i = 1; i < depth + 1; i++) {
+                chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+                uint64_t moves = perftDivide(i, nullStream);
+                chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+                int64_t timeUs = max<int64_t>(chrono::duration_cast<chrono::microseconds>(end - begin).count(), 1);
+                output << "Depth: " << i << " ply Result: " << moves << " positions Time: " << timeUs / 1000
+                       << "ms NPS: " << moves * 1000000 / timeUs << endl;
             }
-            alpha = max(bestSoFar.eval, alpha);
-            if (beta <= alpha) break;
         }
 
-        return bestSoFar;
+        return output.str();
     }
 
-    int searchCaptures(int alpha, int beta) {
-        int eval = evaluate();
-        if (eval >= beta) {
-            return beta;
-        }
-        alpha = max(alpha, eval);
+    // Splits the root moves (and the replies when there are too few root moves to go around) over the perft
+    // threads, each walking its share on its own copy of the board. Prints the count for every root move
+    uint64_t perftDivide(int depth, ostream& output) {
+        if (depth == 0) return 1;
 
-        stackvector<Move, MAX_MOVES> moves = m_board.generateLegalMoves();
-        orderMoves(moves, false);
+        MoveList moves;
+        m_board.generateMoves<GenType::LEGAL>(moves);
 
+        bool split = moves.size() < 2 * m_perftTables.size() && depth >= 3;
+
+        vector<PerftWork> work;
         for (Move move : moves) {
-            if (!Piece::isColor(m_board.getPiece(move.getTo()), m_board.getNextTurn())) continue;
+            MoveList replies;
 
-            m_board.makeMove(move);
-            int eval = -searchCaptures(-beta, -alpha);
-            m_board.unmakeLastMove();
+            if (split) {
+                m_board.makeMove(move);
+                m_board.generateMoves<GenType::LEGAL>(replies);
+                m_board.unmakeLastMove();
+            }
 
-            if (eval >= beta) return beta;
-            alpha = max(alpha, eval);
+            if (!split || replies.empty()) work.push_back(PerftWork{move, Move(), 0});
+            for (Move reply : replies) work.push_back(PerftWork{move, reply, 0});
         }
 
-        return alpha;
-    }
+        atomic<size_t> nextWork(0);
+        auto worker = [&](int threadIndex) {
+            Board board = m_board;
+            board.reserveHistory(depth);
 
-    // Orders moves in place on the array
-    void orderMoves(stackvector<Move, MAX_MOVES>& moves, bool isRoot) {
-        stackvector<int, MAX_MOVES> moveScores;
+            for (size_t i = nextWork++; i < work.size(); i = nextWork++) {
+                PerftWork& item = work[i];
+                int remaining = depth - 1;
 
-        for (Move move : moves) {
-            if (isRoot && move == m_lastBestMove.bestMove) {
-                moveScores.push_back(POS_INF);  // Guarantee that best move gets searched first
-            } else {
-                moveScores.push_back(staticMoveEval(move));
-            }
-        }
+                board.makeMove(item.move);
+                if (!item.reply.isNull()) {
+                    board.makeMove(item.reply);
+                    remaining--;
+                }
 
-        // Sort move array based on move scores (insertion sort)
-        for (size_t i = 1; i < moves.size(); i++) {
-            int scoreKey = moveScores[i];
-            Move moveKey = moves[i];
+                item.nodes = perftCount(board, m_perftTables[threadIndex], remaining);
 
-            size_t j;
-            for (j = i; j > 0 && scoreKey > moveScores[j - 1]; j--) {
-                moveScores[j] = moveScores[j - 1];
-                moves[j] = moves[j - 1];
+                if (!item.reply.isNull()) board.unmakeLastMove();
+                board.unmakeLastMove();
             }
-            moveScores[j] = scoreKey;
-            moves[j] = moveKey;
+        };
+
+        vector<thread> threads;
+        for (size_t i = 1; i < m_perftTables.size(); i++) threads.push_back(thread(worker, i));
+        worker(0);
+        for (thread& t : threads) t.join();
+
+        // Work is in root move order, so the replies of one root move are next to each other
+        uint64_t total = 0;
+        for (size_t i = 0; i < work.size(); i++) {
+            uint64_t nodes = work[i].nodes;
+            while (i + 1 < work.size() && work[i + 1].move == work[i].move) nodes += work[++i].nodes;
+
+            output << work[i].move.toUci() << ": " << nodes << endl;
+            total += nodes;
         }
+
+        return total;
     }
 
-    int staticMoveEval(Move move) {
-        int score = 0;
-        int movedPiece = m_board.getPiece(move.getFrom());
-        int capturedPiece = m_board.getPiece(move.getTo());
+    static uint64_t perftCount(Board& board, PerftTable& table, int depth) {
+        if (depth == 0) return 1;
 
-        // Capture opponents high value pieces with our low value pieces
-        if (capturedPiece != Piece::NONE)
-            score += 10 * Piece::getMaterialValue(capturedPiece) - Piece::getMaterialValue(movedPiece);
+        MoveList moves;
+        board.generateMoves<GenType::LEGAL>(moves);
 
-        // Promotion is probably good
-        if (move.getFlags() != Flag::NONE) score += Piece::getMaterialValue(move.getPromotionPiece());
+        // Every generated move is legal, so the last ply only needs counting
+        if (depth == 1) return moves.size();
 
-        // Don't move piece to somewhere attacked by a pawn
-        if (m_board.isAttackedByPawn(move.getTo(), m_board.getNextTurn())) score -= Piece::getMaterialValue(movedPiece);
+        uint64_t total = 0;
+        if (table.enabled() && table.probe(board.getHash(), depth, total)) return total;
 
-        return score;
-    }
+        for (Move move : moves) {
+            board.makeMove(move);
+            total += perftCount(board, table, depth - 1);
+            board.unmakeLastMove();
+        }
 
-    int evaluate() {
-        m_positionsSearched++;
+        if (table.enabled()) table.store(board.getHash(), depth, total);
 
-        int eval = 0;
+        return total;
+    }
 
-        int numPieces = 0;
+    // Parses and writes a fixed set of FENs on a scratch board, reports throughput of each
+    string benchFen(int iterations) {
+        constexpr string_view FENS[] = {
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+            "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+            "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+            "rnbqkbnr/pp1ppppp/8/2p5/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2",
+        };
+        constexpr int NUM_FENS = sizeof(FENS) / sizeof(FENS[0]);
+
+        Board board(m_debugStream);
+        char buffer[MAX_FEN_LENGTH];
+        uint64_t checksum = 0;  // Keeps the work from being optimised away
 
-        // Compute material from White's perspective
-        for (int piece : Piece::ALL_PIECES) {
-            int num = BitBoard::getNumToggled(m_board.getBitboard(piece));
-            eval += Piece::getMaterialValue(piece) * num * (Piece::isColor(piece, m_board.getTurn()) ? 1 : -1);
-            numPieces += num;
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            board.setBoard(FENS[i % NUM_FENS]);
+            checksum += board.getHash();
         }
+        chrono::steady_clock::time_point parsed = chrono::steady_clock::now();
 
-        for (int piece : Piece::ALL_PIECES) {
-            for (int pos : m_board.getPieceLocations(piece)) {
-                eval += PieceValues::getPieceSquareValue(piece, pos, numPieces) *
-                        (Piece::isColor(piece, m_board.getTurn()) ? 1 : -1);
-            }
+        for (int i = 0; i < iterations; i++) {
+            checksum += board.writeFen(buffer) + buffer[i % 8];
         }
+        chrono::steady_clock::time_point written = chrono::steady_clock::now();
 
-        return eval;
-    }
+        int64_t parseUs = max<int64_t>(chrono::duration_cast<chrono::microseconds>(parsed - begin).count(), 1);
+        int64_t writeUs = max<int64_t>(chrono::duration_cast<chrono::microseconds>(written - parsed).count(), 1);
 
-    MoveEval getBestMove(int searchDepth, int maxSearchTimeMs = POS_INF) {
-        return moveSearch(searchDepth, maxSearchTimeMs);
-        // return MoveEval(0, Move(0, 1));
+        stringstream output;
+        output << "Parsed " << iterations << " FENs in " << parseUs / 1000 << "ms ("
+               << (uint64_t)iterations * 1000000 / parseUs << " per second)" << endl;
+        output << "Wrote " << iterations << " FENs in " << writeUs / 1000 << "ms ("
+               << (uint64_t)iterations * 1000000 / writeUs << " per second)" << endl;
+        output << "Checksum " << checksum << endl;
+
+        return output.str();
     }
 
-    int getPiece(int square) { return m_board.getPiece(square); }
+    // Each perft thread gets its own table, so the hash size is split between them. The new tables are allocated before
+    // the old ones go, so a size that can't be allocated throws bad_alloc and leaves them as they were
+    void resizePerftTables(int threads, int sizeMb) {
+        sizeMb = max(sizeMb, 0);
 
-    string getFen() const { return m_board.getFen(); }
+        vector<PerftTable> tables(threads);
+        for (PerftTable& table : tables) table.resize(sizeMb / threads);
 
-    string perft(int depth, bool multiDepth = false) {
-        stringstream output;
+        m_perftTables.swap(tables);
+        m_perftHashSize = sizeMb;
+    }
 
-        output << "\n";
+    // 0 turns the perft table off
+    void setPerftHashSize(int sizeMb) { resizePerftTables(m_perftTables.size(), sizeMb); }
 
-        if (!multiDepth) {
-            int val = moveTest(depth, depth, output);
-            output << "\nMoves searched: " << val << endl;
+    // Starts the table over empty, or throws bad_alloc and keeps the old table when there isn't the memory
+    void setHashSize(int sizeMb) {
+        m_transpositionTable.resize(max(sizeMb, 1));
+        m_debugStream << "Hash: " << sizeMb << "MB" << (m_transpositionTable.usesHugeTlb() ? " on huge pages" : "")
+                      << endl;
+    }
 
-        } else {
-            stringstream nullStream;
-            for (int i = 1; i < depth + 1; i++) {
-                chrono::steady_clock::time_point begin = chrono::steady_clock::now();
-                int moves = moveTest(i, i, nullStream);
-                chrono::steady_clock::time_point end = chrono::steady_clock::now();
-                output << "Depth: " << i << " ply Result: " << moves
-                       << " positions Time: " << chrono::duration_cast<chrono::milliseconds>(end - begin).count()
-                       << "ms" << endl;
-            }
-        }
+    void clearHash() { m_transpositionTable.clear(); }
 
-        return output.str();
+    SearchOptions& getSearchOptions() { return m_searchOptions; }
+
+    // Search and perft threads
+    void setThreads(int threads) {
+        threads = max(threads, 1);
+        resizePerftTables(threads, m_perftHashSize);
+        m_threads = threads;
     }
 
-    int moveTest(int depth, int topDepth, stringstream& output) {
-        if (depth == 0) return 1;
+    const PositionInfo& getPositionInfo() {
+        // The key check also catches the board changing without going through makeMove or newGame
+        if (m_positionInfo.valid && m_positionInfo.key == m_board.getHash()) return m_positionInfo;
 
-        int total = 0;
+        m_positionInfo.moves.clear();
+        m_board.generateMoves<GenType::LEGAL>(m_positionInfo.moves);
+        m_positionInfo.isCheck = m_board.isCheck();
+        m_positionInfo.key = m_board.getHash();
+        m_positionInfo.valid = true;
 
-        for (Move move : m_board.generateLegalMoves()) {
-            m_board.makeMove(move);
-            int val = moveTest(depth - 1, topDepth, output);
-            total += val;
-            if (depth == topDepth) {
-                output << move.toUci() << ": " << val << endl;
-            }
-            m_board.unmakeLastMove();
-        }
-
-        return total;
+        return m_positionInfo;
     }
 
     vector<Move> getLegalMoves() {
-        vector<Move> moves;
-        stackvector<Move, MAX_MOVES> stackMoves = m_board.generateLegalMoves();
-
-        moves.insert(moves.end(), stackMoves.begin(), stackMoves.end());
-        return moves;
+        const MoveList& moves = getPositionInfo().moves;
+        return vector<Move>(moves.begin(), moves.end());
     }
 
     // Game winner can be none, white, black, draw
     string getGameWinner() {
-        stackvector<Move, MAX_MOVES> moves = m_board.generateLegalMoves();
+        const PositionInfo& info = getPositionInfo();
 
-        if (moves.empty()) {
-            if (m_board.isCheck()) return m_board.getTurn() == Piece::WHITE ? "black" : "white";
+        if (info.moves.empty()) {
+            if (info.isCheck) return m_board.getTurn() == Piece::WHITE ? "black" : "white";
             return "draw";
         }
 
+        // Threefold repetition and the fifty move rule, the game history comes from position ... moves
+        if (m_board.isFiftyMoveDraw() || m_board.isRepetition(2)) return "draw";
+
         return "none";
     }
 };
\ No newline at end of file
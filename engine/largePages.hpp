@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+using namespace std;
+
+/**
+ * @brief Zeroed memory for big tables, on 2 MB pages when the OS hands them out so random probes need one TLB entry
+ * per 2 MB instead of per 4 KB. Tries explicit huge pages (MAP_HUGETLB), then asks for transparent huge pages with
+ * madvise, then settles for plain memory aligned to 2 MB.
+ */
+class LargePageBuffer {
+   private:
+    void* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;  // MAP_HUGETLB memory goes back with munmap
+
+   public:
+    LargePageBuffer() = default;
+    LargePageBuffer(const LargePageBuffer&) = delete;
+    LargePageBuffer& operator=(const LargePageBuffer&) = delete;
+    ~LargePageBuffer() { release(); }
+
+    // The new memory comes before the old is freed, so a size that can't be allocated throws bad_alloc and leaves the
+    // buffer as it was. Size is rounded up to whole huge pages
+    void allocate(size_t bytes) {
+        if (bytes == 0) {
+            release();
+            return;
+        }
+
+        size_t size = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        void* data = nullptr;
+        bool mapped = false;
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data == MAP_FAILED)
+            data = nullptr;
+        else
+            mapped = true;  // Anonymous mappings start zeroed
+#endif
+
+        if (!data) {
+#ifdef _WIN32
+            data = _aligned_malloc(size, HUGE_PAGE_SIZE);
+#else
+            data = aligned_alloc(HUGE_PAGE_SIZE, size);
+#endif
+            if (!data) throw bad_alloc();
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            madvise(data, size, MADV_HUGEPAGE);
+#endif
+            memset(data, 0, size);
+        }
+
+        release();
+        m_data = data;
+        m_size = size;
+        m_mapped = mapped;
+    }
+
+    void release() {
+        if (!m_data) return;
+
+#ifdef __linux__
+        if (m_mapped) munmap(m_data, m_size);
+#endif
+#ifdef _WIN32
+        if (!m_mapped) _aligned_free(m_data);
+#else
+        if (!m_mapped) free(m_data);
+#endif
+
+        m_data = nullptr;
+        m_size = 0;
+        m_mapped = false;
+    }
+
+    void clear() {
+        if (m_data) memset(m_data, 0, m_size);
+    }
+
+    inline void* data() const { return m_data; }
+    inline size_t size() const { return m_size; }
+    inline bool isHugeTlb() const { return m_mapped; }
+};
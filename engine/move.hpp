@@ -1,23 +1,29 @@
 #pragma once
 
+#include <stdint.h>
+
 #include <iostream>
 #include <string>
 
 #include "piece.hpp"
 #include "square.hpp"
 
-#define MAX_MOVES 218       // Max moves in a chess position
-#define MAX_PIECE_MOVES 27  // Max moves a single piece can make
-#define MAX_MOVE_LINES 8
+#define MAX_MOVES 218  // Max moves in a chess position
 
 using namespace std;
 
+// Move kinds, stored in the top 4 bits of a Move
 namespace Flag {
 constexpr int NONE = 0;
-constexpr int PROMOTION_QUEEN = 0b1000;
-constexpr int PROMOTION_ROOK = 0b0100;
-constexpr int PROMOTION_BISHOP = 0b0010;
-constexpr int PROMOTION_KNIGHT = 0b0001;
+constexpr int CASTLE = 0b0001;
+constexpr int EN_PASSANT = 0b0010;
+
+// Promotions set the top bit, the low bits are the piece offset from a knight
+constexpr int PROMOTION = 0b1000;
+constexpr int PROMOTION_KNIGHT = 0b1000;
+constexpr int PROMOTION_BISHOP = 0b1001;
+constexpr int PROMOTION_ROOK = 0b1010;
+constexpr int PROMOTION_QUEEN = 0b1011;
 
 int fromPiece(int piece) {
     switch (piece) {
@@ -66,110 +72,57 @@ char toChar(int flag) {
 
 }  // namespace Flag
 
-class MoveLine {
+// Packed into 16 bits: from (6), to (6), flag (4)
+class Move {
    private:
-    int m_from;
-    int m_to;
+    uint16_t m_data;
 
    public:
-    static const int CHECK = 0;
-    static const int PIN = 1;
-
-    // Null MoveLine
-    MoveLine() : m_from(-1), m_to(-1) {}
-
-    // Defined MoveLine
-    MoveLine(int from, int to) : m_from(from), m_to(to) {}
-
-    inline int getFrom() const { return m_from; }
-    inline int getTo() const { return m_to; }
-
-    bool isNull() const { return m_from == -1 && m_to == -1; }
-
-    // Returns if square falls within the pin line
-    bool inLine(int square) const {
-        // Horizontal pin
-        if (Square::rank(m_from) == Square::rank(m_to) && Square::file(m_from) != Square::file(m_to)) {
-            return Square::rank(square) == Square::rank(m_from) &&
-                   inBetween(Square::file(square), Square::file(m_from), Square::file(m_to));
-        }
-
-        // Vertical pin
-        if (Square::rank(m_from) != Square::rank(m_to) && Square::file(m_from) == Square::file(m_to)) {
-            return Square::file(square) == Square::file(m_from) &&
-                   inBetween(Square::rank(square), Square::rank(m_from), Square::rank(m_to));
-        }
-
-        // Upward Diagonal
-        if ((m_from - m_to) % 9 == 0 && (m_from - square) % 9 == 0 &&
-            abs(Square::rank(m_from) - Square::rank(square)) == abs(Square::file(m_from) - Square::file(square))) {
-            return inBetween(square, m_from, m_to);
-        }
+    Move() : m_data(0) {}
+    Move(int from, int to, int flags) : m_data(from | (to << 6) | (flags << 12)) {}
+    Move(int from, int to) : m_data(from | (to << 6)) {}
 
-        // Downward Diagonal
-        if ((m_from - m_to) % 7 == 0 && (m_from - square) % 7 == 0 &&
-            abs(Square::rank(m_from) - Square::rank(square)) == abs(Square::file(m_from) - Square::file(square))) {
-            return inBetween(square, m_from, m_to);
-        }
+    // Castle and en passant kinds can't be told from the string, see Board::parseMove
+    Move(string uci) {
+        int from = Square::fromUci(uci.substr(0, 2));
+        int to = Square::fromUci(uci.substr(2, 2));
+        int flags = uci.length() > 4 ? Flag::fromChar(uci.at(4)) : Flag::NONE;
 
-        return false;
+        m_data = from | (to << 6) | (flags << 12);
     }
-};
 
-class Move {
-   private:
-    int m_from;
-    int m_to;
-    int m_flags;  // 8 == q, 4 == r, 2 == b, 1 == n
+    inline int getFrom() const { return m_data & 0x3f; }
+    inline int getTo() const { return (m_data >> 6) & 0x3f; }
+    inline int getFlags() const { return m_data >> 12; }
+    inline int dx() const { return Square::file(getTo()) - Square::file(getFrom()); }
+    inline int dy() const { return Square::rank(getTo()) - Square::rank(getFrom()); }
 
-   public:
-    Move() : m_from(0), m_to(0), m_flags(0) {}
-    Move(int from, int to, int flags) : m_from(from), m_to(to), m_flags(flags) {}
-    Move(int from, int to) : m_from(from), m_to(to), m_flags(0) {}
-    Move(string uci) {
-        m_from = Square::fromUci(uci.substr(0, 2));
-        m_to = Square::fromUci(uci.substr(2, 2));
+    inline bool isNull() const { return m_data == 0; }
 
-        if (uci.length() > 4) {
-            m_flags = Flag::fromChar(uci.at(4));
-        } else {
-            m_flags = Flag::NONE;
-        }
+    // Raw 16 bits, for packing into hash table entries
+    inline uint16_t getData() const { return m_data; }
+    static Move fromData(uint16_t data) {
+        Move move;
+        move.m_data = data;
+        return move;
     }
-
-    inline int getFrom() const { return m_from; }
-    inline int getTo() const { return m_to; }
-    inline int getFlags() const { return m_flags; }
-    inline int dx() const { return Square::file(m_to) - Square::file(m_from); }
-    inline int dy() const { return Square::rank(m_to) - Square::rank(m_from); }
-
-    inline bool isNull() const { return m_from == 0 && m_to == 0 && m_flags == 0; }
-    inline int isPromotion() const { return m_flags != Flag::NONE; }
-    int getPromotionPiece() const {
-        switch (m_flags) {
-            case Flag::PROMOTION_QUEEN:
-                return Piece::QUEEN;
-            case Flag::PROMOTION_ROOK:
-                return Piece::ROOK;
-            case Flag::PROMOTION_BISHOP:
-                return Piece::BISHOP;
-            case Flag::PROMOTION_KNIGHT:
-                return Piece::KNIGHT;
-            default:
-                return Piece::NONE;
-        }
+    inline bool isPromotion() const { return getFlags() & Flag::PROMOTION; }
+    inline bool isCastle() const { return getFlags() == Flag::CASTLE; }
+    inline bool isEnPassant() const { return getFlags() == Flag::EN_PASSANT; }
+    inline int getPromotionPiece() const {
+        return isPromotion() ? Piece::KNIGHT + (getFlags() & 0b11) : Piece::NONE;
     }
 
     string toUci(bool ignore_illegal = false) const {
         if (isPromotion()) {
-            return Square::toUci(m_from, ignore_illegal) + Square::toUci(m_to, ignore_illegal) + Flag::toChar(m_flags);
+            return Square::toUci(getFrom(), ignore_illegal) + Square::toUci(getTo(), ignore_illegal) +
+                   Flag::toChar(getFlags());
         }
-        return Square::toUci(m_from, ignore_illegal) + Square::toUci(m_to, ignore_illegal);
+        return Square::toUci(getFrom(), ignore_illegal) + Square::toUci(getTo(), ignore_illegal);
     }
 
-    bool operator==(const Move& rhs) const {
-        return (m_from == rhs.m_from) && (m_to == rhs.m_to) && (m_flags == rhs.m_flags);
-    }
+    inline bool operator==(const Move& rhs) const { return m_data == rhs.m_data; }
+    inline bool operator!=(const Move& rhs) const { return m_data != rhs.m_data; }
 
     static vector<string> getUciList(const vector<Move>& moves, bool ignore_illegal = false) {
         vector<string> uciList;
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Subtree counts of positions perft has already walked, keyed by Zobrist key and depth. Entries are always
+ * replaced, a size of 0 disables the table.
+ */
+class PerftTable {
+   private:
+    struct Entry {
+        uint64_t key;
+        uint64_t nodes;
+        int depth;  // 0 marks an empty entry, perft never stores depth 0
+    };
+
+    vector<Entry> m_entries;
+    uint64_t m_mask = 0;
+
+   public:
+    // Size is rounded down to a power of two number of entries. Throws bad_alloc and keeps the old entries if the new
+    // ones can't be allocated
+    void resize(size_t sizeMb) {
+        size_t numEntries = sizeMb * 1024 * 1024 / sizeof(Entry);
+
+        size_t powerOfTwo = 1;
+        while (powerOfTwo * 2 <= numEntries) powerOfTwo *= 2;
+
+        vector<Entry> entries(numEntries == 0 ? 0 : powerOfTwo, Entry{0, 0, 0});
+        m_entries.swap(entries);
+        m_mask = m_entries.empty() ? 0 : m_entries.size() - 1;
+    }
+
+    inline bool enabled() const { return !m_entries.empty(); }
+
+    bool probe(uint64_t key, int depth, uint64_t& nodes) const {
+        const Entry& entry = m_entries[key & m_mask];
+        if (entry.key != key || entry.depth != depth) return false;
+
+        nodes = entry.nodes;
+        return true;
+    }
+
+    void store(uint64_t key, int depth, uint64_t nodes) { m_entries[key & m_mask] = Entry{key, nodes, depth}; }
+};
@@ -0,0 +1,82 @@
+// Perft regression and timing suite
+// Build: g++ -O3 -o perft_suite perft_suite.cpp
+// Usage: perft_suite [epd file] [max depth] [threads] [perft hash MB]
+//
+// Each EPD line is a FEN followed by the expected node counts, e.g.
+//     rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 ;D1 20 ;D2 400
+// Exits with 1 if any count doesn't match.
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "engine.hpp"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    string epdPath = argc > 1 ? argv[1] : "tests/perft.epd";
+    int maxDepth = argc > 2 ? stoi(argv[2]) : POS_INF;
+    int threads = argc > 3 ? stoi(argv[3]) : 1;
+    int hashMb = argc > 4 ? stoi(argv[4]) : 0;
+
+    ifstream epd(epdPath);
+    if (!epd) {
+        cerr << "Could not open " << epdPath << endl;
+        return 1;
+    }
+
+    stringstream nullStream;
+    Engine engine(nullStream, nullStream);
+    engine.setThreads(threads);
+    engine.setPerftHashSize(hashMb);
+
+    int failures = 0;
+    uint64_t totalNodes = 0;
+    int64_t totalUs = 0;
+
+    string line;
+    while (getline(epd, line)) {
+        size_t fenEnd = line.find(';');
+        if (line.empty() || line[0] == '#' || fenEnd == string::npos) continue;
+
+        string fen = line.substr(0, fenEnd);
+        engine.newGame(fen);
+        cout << fen << endl;
+
+        // Remaining fields look like ";D<depth> <nodes>"
+        stringstream fields(line.substr(fenEnd));
+        string field;
+        while (getline(fields, field, ';')) {
+            stringstream entry(field);
+            char tag;
+            int depth;
+            uint64_t expected;
+            if (!(entry >> tag >> depth >> expected) || tag != 'D' || depth > maxDepth) continue;
+
+            chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+            uint64_t nodes = engine.perftDivide(depth, nullStream);
+            chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+            int64_t timeUs = max<int64_t>(chrono::duration_cast<chrono::microseconds>(end - begin).count(), 1);
+            totalNodes += nodes;
+            totalUs += timeUs;
+
+            bool passed = nodes == expected;
+            if (!passed) failures++;
+
+            cout << "    " << (passed ? "ok  " : "FAIL") << " depth " << depth << " nodes " << setw(11) << nodes;
+            if (!passed) cout << " expected " << expected;
+            cout << " time " << setw(7) << timeUs / 1000 << "ms NPS " << nodes * 1000000 / timeUs << endl;
+        }
+    }
+
+    cout << "\nTotal nodes " << totalNodes << " time " << totalUs / 1000 << "ms NPS "
+         << totalNodes * 1000000 / max<int64_t>(totalUs, 1) << endl;
+    cout << (failures ? to_string(failures) + " FAILED" : "All passed") << endl;
+
+    return failures ? 1 : 0;
+}
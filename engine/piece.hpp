@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <stdexcept>
+
 using namespace std;
 
 namespace Piece {
@@ -23,47 +26,34 @@ constexpr int ALL_PIECES[12] = {Piece::PAWN | Piece::WHITE, Piece::KNIGHT | Piec
                                 Piece::PAWN | Piece::BLACK, Piece::KNIGHT | Piece::BLACK, Piece::BISHOP | Piece::BLACK,
                                 Piece::ROOK | Piece::BLACK, Piece::QUEEN | Piece::BLACK,  Piece::KING | Piece::BLACK};
 
-inline bool isColor(int piece, int color) { return (piece & COLOR_MASK) == color; }
-inline bool isType(int piece, int type) { return (piece & TYPE_MASK) == type; }
+constexpr bool isColor(int piece, int color) { return (piece & COLOR_MASK) == color; }
+constexpr bool isType(int piece, int type) { return (piece & TYPE_MASK) == type; }
 
-inline int getPieceType(int piece) { return piece & TYPE_MASK; }
-inline int getColor(int piece) { return piece & COLOR_MASK; }
+constexpr int getPieceType(int piece) { return piece & TYPE_MASK; }
+constexpr int getColor(int piece) { return piece & COLOR_MASK; }
 
 // Warning: Undefined behaviour for non color input
-inline int getOppositeColor(int color) { return color ^ 0b11000; }
+constexpr int getOppositeColor(int color) { return color ^ 0b11000; }
 
-int fromChar(char c) {
-    int piece = 0;
-    switch (tolower(c)) {
-        case 'p':
-            piece = Piece::PAWN;
-            break;
-        case 'n':
-            piece = Piece::KNIGHT;
-            break;
-        case 'b':
-            piece = Piece::BISHOP;
-            break;
-        case 'r':
-            piece = Piece::ROOK;
-            break;
-        case 'q':
-            piece = Piece::QUEEN;
-            break;
-        case 'k':
-            piece = Piece::KING;
-            break;
-        default:
-            // cout << c << endl;
-            throw invalid_argument("Unknown piece type in fromChar in Piece");
-    }
+// Piece for each FEN letter, NONE for anything that isn't one
+constexpr array<int, 128> charTable() {
+    array<int, 128> table = {};
+    const char letters[] = "pnbrqk";
 
-    if (isupper(c)) {
-        piece |= Piece::WHITE;
-    } else {
-        piece |= Piece::BLACK;
+    for (int type = PAWN; type <= KING; type++) {
+        table[letters[type - PAWN]] = BLACK | type;
+        table[letters[type - PAWN] - 'a' + 'A'] = WHITE | type;
     }
 
+    return table;
+}
+
+constexpr array<int, 128> PIECE_FROM_CHAR = charTable();
+
+int fromChar(char c) {
+    int piece = (unsigned char)c < 128 ? PIECE_FROM_CHAR[c] : NONE;
+    if (piece == NONE) throw invalid_argument("Unknown piece type in fromChar in Piece");
+
     return piece;
 }
 
@@ -126,4 +116,7 @@ int getMaterialValue(int piece) {
     }
 }
 
+// Indexed by piece type for exchanges, the king is worth more than anything it could win so it only captures last
+constexpr int SEE_VALUES[7] = {0, 100, 300, 320, 500, 900, 20000};
+
 };  // namespace Piece
\ No newline at end of file
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <cstring>
+
+#include "bitboard.hpp"
+#include "move.hpp"
+#include "piece.hpp"
+#include "positionHash.hpp"
+#include "square.hpp"
+
+using namespace std;
+
+// Castling rights that survive a move touching each square, 0b1111 is wk, wq, bk, bq
+constexpr int CASTLING_RIGHTS_MASK[64] = {
+    0b1011, 0b1111, 0b1111, 0b1111, 0b0011, 0b1111, 0b1111, 0b0111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111,
+    0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111,
+    0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111,
+    0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111,
+    0b1111, 0b1111, 0b1111, 0b1111, 0b1110, 0b1111, 0b1111, 0b1111, 0b1100, 0b1111, 0b1111, 0b1101};
+
+/**
+ * @brief Everything that describes a position, small and trivially copyable. Board keeps one per ply when built
+ * with COPY_MAKE, and a search thread can copy-make on its own with
+ *     Position child = parent;
+ *     child.makeMove(move);
+ * Move generation stays on Board.
+ */
+struct Position {
+    uint64_t bitboards[NUM_BITBOARDS];
+    PositionHash hash;
+    PositionHash pawnHash;      // Pawns only, for pawn structure caches
+    PositionHash materialHash;  // Piece counts only, keyed as if the nth piece of a kind stood on square n
+    int8_t board[NUM_SQUARES];
+    int16_t halfmove;
+    int16_t fullmove;
+    int8_t turn;
+    int8_t castling;   // 0b1111, white kingside, white queenside, black kingside, black queenside
+    int8_t enPassant;  // -1 signifies no en passant available
+
+    void clear() {
+        memset(bitboards, 0, sizeof(bitboards));
+        memset(board, Piece::NONE, sizeof(board));
+        hash.reset();
+        pawnHash.reset();
+        materialHash.reset();
+
+        turn = Piece::WHITE;
+        castling = 0;
+        enPassant = -1;
+        halfmove = 0;
+        fullmove = 1;
+    }
+
+    inline int getPiece(int square) const { return board[square]; }
+
+    inline int getCount(int piece) const {
+        return BitBoard::getNumToggled(bitboards[BitBoard::getBoardIndex(piece)]);
+    }
+
+    // The keys from scratch rather than incrementally
+
+    uint64_t computeKey() const {
+        PositionHash key;
+
+        for (int square = 0; square < NUM_SQUARES; square++) {
+            if (board[square] != Piece::NONE) key.togglePiece(board[square], square);
+        }
+
+        if (turn == Piece::BLACK) key.toggleTurn();
+        key.toggleCastlingRights(castling);
+        if (enPassant != -1) key.toggleEnPassant(Square::file(enPassant));
+
+        return key.get();
+    }
+
+    uint64_t computePawnKey() const {
+        PositionHash key;
+
+        for (int square = 0; square < NUM_SQUARES; square++) {
+            if (Piece::getPieceType(board[square]) == Piece::PAWN) key.togglePiece(board[square], square);
+        }
+
+        return key.get();
+    }
+
+    uint64_t computeMaterialKey() const {
+        PositionHash key;
+
+        for (int piece : Piece::ALL_PIECES) {
+            for (int count = 0; count < getCount(piece); count++) key.togglePiece(piece, count);
+        }
+
+        return key.get();
+    }
+
+    void computeKeys() {
+        hash.set(computeKey());
+        pawnHash.set(computePawnKey());
+        materialHash.set(computeMaterialKey());
+    }
+
+    // Pawn and material keys for a piece arriving or leaving, the main key is handled by the caller
+    inline void togglePieceKeys(int piece, int square, int count) {
+        if (Piece::getPieceType(piece) == Piece::PAWN) pawnHash.togglePiece(piece, square);
+        materialHash.togglePiece(piece, count);
+    }
+
+    // Square must be empty
+    template <bool UpdateHash = true>
+    inline void putPiece(int square, int piece) {
+        uint64_t bit = 1ULL << square;
+
+        if (UpdateHash) {
+            hash.togglePiece(piece, square);
+            togglePieceKeys(piece, square, getCount(piece));
+        }
+
+        bitboards[BitBoard::getBoardIndex(piece)] |= bit;
+        bitboards[BitBoard::getColorIndex(Piece::getColor(piece))] |= bit;
+        bitboards[BitBoard::ALL_PIECES] |= bit;
+
+        board[square] = piece;
+    }
+
+    // Square must be occupied
+    template <bool UpdateHash = true>
+    inline void removePiece(int square) {
+        int piece = board[square];
+        uint64_t bit = 1ULL << square;
+
+        bitboards[BitBoard::getBoardIndex(piece)] ^= bit;
+        bitboards[BitBoard::getColorIndex(Piece::getColor(piece))] ^= bit;
+        bitboards[BitBoard::ALL_PIECES] ^= bit;
+        if (UpdateHash) {
+            hash.togglePiece(piece, square);
+            togglePieceKeys(piece, square, getCount(piece));
+        }
+
+        board[square] = Piece::NONE;
+    }
+
+    // From must be occupied, to must be empty
+    template <bool UpdateHash = true>
+    inline void movePiece(int from, int to) {
+        int piece = board[from];
+        uint64_t bits = (1ULL << from) | (1ULL << to);
+
+        bitboards[BitBoard::getBoardIndex(piece)] ^= bits;
+        bitboards[BitBoard::getColorIndex(Piece::getColor(piece))] ^= bits;
+        bitboards[BitBoard::ALL_PIECES] ^= bits;
+        if (UpdateHash) {
+            hash.togglePiece(piece, from);
+            hash.togglePiece(piece, to);
+
+            if (Piece::getPieceType(piece) == Piece::PAWN) {
+                pawnHash.togglePiece(piece, from);
+                pawnHash.togglePiece(piece, to);
+            }
+        }
+
+        board[to] = piece;
+        board[from] = Piece::NONE;
+    }
+
+    // Caller must make sure move is pseudo-legal
+    void makeMove(const Move move) {
+        if (turn == Piece::WHITE)
+            makeMove<Piece::WHITE>(move);
+        else
+            makeMove<Piece::BLACK>(move);
+    }
+
+    // Returns the captured piece
+    template <int Us>
+    int makeMove(const Move move) {
+        constexpr int Them = Piece::getOppositeColor(Us);
+        constexpr int dir = Us == Piece::WHITE ? 8 : -8;
+        constexpr int kingSideRookFrom = Us == Piece::WHITE ? Square::H1 : Square::H8;
+        constexpr int kingSideRookTo = Us == Piece::WHITE ? Square::F1 : Square::F8;
+        constexpr int queenSideRookFrom = Us == Piece::WHITE ? Square::A1 : Square::A8;
+        constexpr int queenSideRookTo = Us == Piece::WHITE ? Square::D1 : Square::D8;
+
+        int from = move.getFrom();
+        int to = move.getTo();
+        int pieceType = Piece::getPieceType(board[from]);
+        int capturedPiece = board[to];
+
+        if (capturedPiece != Piece::NONE) removePiece(to);
+        movePiece(from, to);
+
+        int previousEnPassant = enPassant;
+        enPassant = -1;
+
+        switch (move.getFlags()) {
+            case Flag::NONE:
+                // If a pawn jumps 2 squares then record the enpassant square
+                if (pieceType == Piece::PAWN && to - from == 2 * dir) enPassant = from + dir;
+                break;
+
+            case Flag::EN_PASSANT:
+                capturedPiece = board[to - dir];
+                removePiece(to - dir);
+                break;
+
+            case Flag::CASTLE:
+                if (to > from)
+                    movePiece(kingSideRookFrom, kingSideRookTo);
+                else
+                    movePiece(queenSideRookFrom, queenSideRookTo);
+                break;
+
+            // Promotions, change the end piece type
+            default:
+                removePiece(to);
+                putPiece(to, Us | move.getPromotionPiece());
+                break;
+        }
+
+        // Moving from or capturing on a king or rook square removes castling rights
+        int previousCastling = castling;
+        castling &= CASTLING_RIGHTS_MASK[from] & CASTLING_RIGHTS_MASK[to];
+
+        halfmove += 1;
+        if (capturedPiece != Piece::NONE || pieceType == Piece::PAWN) halfmove = 0;
+
+        turn = Them;
+        if (Us == Piece::BLACK) fullmove += 1;
+
+        hash.toggleTurn();
+        hash.toggleCastlingRights(previousCastling ^ castling);  // Toggle changed bits
+
+        if (previousEnPassant != -1) hash.toggleEnPassant(Square::file(previousEnPassant));
+        if (enPassant != -1) hash.toggleEnPassant(Square::file(enPassant));
+
+        return capturedPiece;
+    }
+
+    // Passes the turn without moving, for null move pruning. The halfmove clock restarts since no position before a
+    // pass can repeat one after it
+    void makeNullMove() {
+        if (enPassant != -1) hash.toggleEnPassant(Square::file(enPassant));
+        enPassant = -1;
+        halfmove = 0;
+
+        turn = Piece::getOppositeColor(turn);
+        hash.toggleTurn();
+    }
+
+    // Us is the side that made the move. Puts the pieces back and hands the turn back, the caller restores the
+    // castling rights, en passant square, halfmove clock and keys
+    template <int Us>
+    void unmakeMove(const Move move, int capturedPiece) {
+        constexpr int dir = Us == Piece::WHITE ? 8 : -8;
+        constexpr int kingSideRookFrom = Us == Piece::WHITE ? Square::H1 : Square::H8;
+        constexpr int kingSideRookTo = Us == Piece::WHITE ? Square::F1 : Square::F8;
+        constexpr int queenSideRookFrom = Us == Piece::WHITE ? Square::A1 : Square::A8;
+        constexpr int queenSideRookTo = Us == Piece::WHITE ? Square::D1 : Square::D8;
+
+        int from = move.getFrom();
+        int to = move.getTo();
+
+        // Unmake base move, undoing any promotion
+        if (move.isPromotion()) {
+            removePiece<false>(to);
+            putPiece<false>(from, Us | Piece::PAWN);
+        } else {
+            movePiece<false>(to, from);
+        }
+
+        if (move.isEnPassant())
+            putPiece<false>(to - dir, capturedPiece);
+        else if (capturedPiece != Piece::NONE)
+            putPiece<false>(to, capturedPiece);
+
+        // Unmake the castling move
+        if (move.isCastle() && to > from) movePiece<false>(kingSideRookTo, kingSideRookFrom);
+        if (move.isCastle() && to < from) movePiece<false>(queenSideRookTo, queenSideRookFrom);
+
+        turn = Us;
+        if (Us == Piece::BLACK) fullmove -= 1;
+    }
+};
+
+static_assert(sizeof(Position) <= 216, "Position is copied every ply with COPY_MAKE, keep it small");
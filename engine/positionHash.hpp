@@ -1,6 +1,8 @@
 #pragma once
 
-#include <random>
+#include <stdint.h>
+
+#include <array>
 
 #include "bitboard.hpp"  // To reuse getBoardIndex
 
@@ -16,44 +18,51 @@ constexpr int BLACK_QUEEN_CASTLE = 772;
 
 constexpr int ENPASSANT_FILE_A = 773;
 
-}  // namespace PositionHashIndex
+constexpr int NUM_KEYS = 781;
 
-class PositionHash {
-   private:
-    uint64_t m_hash;
+// splitmix64 from a fixed seed, so the keys are the same every run and built at compile time
+constexpr array<uint64_t, NUM_KEYS> generateIdentityKeys() {
+    array<uint64_t, NUM_KEYS> keys = {};
+    uint64_t state = 835628211787;
 
-    uint64_t m_identityKeys[781];
+    for (int i = 0; i < NUM_KEYS; i++) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        keys[i] = z ^ (z >> 31);
+    }
 
-   public:
-    PositionHash() : m_hash(0) {
-        mt19937_64 engine;
+    return keys;
+}
 
-        uint64_t fixed_seed = 835628211787;
+// Shared by every hash so copying a position only copies the key
+constexpr array<uint64_t, NUM_KEYS> IDENTITY_KEYS = generateIdentityKeys();
 
-        engine.seed(fixed_seed);
+}  // namespace PositionHashIndex
 
-        uniform_int_distribution<uint64_t> dist(0, numeric_limits<uint64_t>::max());
+class PositionHash {
+   private:
+    uint64_t m_hash;
 
-        for (int i = 0; i < 781; i++) {
-            m_identityKeys[i] = dist(engine);
-        }
-    }
+   public:
+    PositionHash() : m_hash(0) {}
 
-    inline uint64_t get() { return m_hash; }
+    inline uint64_t get() const { return m_hash; }
+    inline void set(uint64_t hash) { m_hash = hash; }
 
-    void togglePiece(int piece, int square) { m_hash ^= m_identityKeys[BitBoard::getBoardIndex(piece) * 64 + square]; }
+    void togglePiece(int piece, int square) { m_hash ^= PositionHashIndex::IDENTITY_KEYS[BitBoard::getBoardIndex(piece) * 64 + square]; }
 
-    void toggleTurn() { m_hash ^= m_identityKeys[PositionHashIndex::BLACK_TO_MOVE]; }
+    void toggleTurn() { m_hash ^= PositionHashIndex::IDENTITY_KEYS[PositionHashIndex::BLACK_TO_MOVE]; }
 
     // Pass Rights to toggle, wking, wqueen, bking, bqueen as bits of 4-bit-bin
     void toggleCastlingRights(int rights) {
-        if (rights & 0b1000) m_hash ^= m_identityKeys[PositionHashIndex::WHITE_KING_CASTLE];
-        if (rights & 0b0100) m_hash ^= m_identityKeys[PositionHashIndex::WHITE_QUEEN_CASTLE];
-        if (rights & 0b0010) m_hash ^= m_identityKeys[PositionHashIndex::BLACK_KING_CASTLE];
-        if (rights & 0b0001) m_hash ^= m_identityKeys[PositionHashIndex::BLACK_QUEEN_CASTLE];
+        if (rights & 0b1000) m_hash ^= PositionHashIndex::IDENTITY_KEYS[PositionHashIndex::WHITE_KING_CASTLE];
+        if (rights & 0b0100) m_hash ^= PositionHashIndex::IDENTITY_KEYS[PositionHashIndex::WHITE_QUEEN_CASTLE];
+        if (rights & 0b0010) m_hash ^= PositionHashIndex::IDENTITY_KEYS[PositionHashIndex::BLACK_KING_CASTLE];
+        if (rights & 0b0001) m_hash ^= PositionHashIndex::IDENTITY_KEYS[PositionHashIndex::BLACK_QUEEN_CASTLE];
     }
 
-    void toggleEnPassant(int file) { m_hash ^= m_identityKeys[PositionHashIndex::ENPASSANT_FILE_A + file]; }
+    void toggleEnPassant(int file) { m_hash ^= PositionHashIndex::IDENTITY_KEYS[PositionHashIndex::ENPASSANT_FILE_A + file]; }
 
     void reset() { m_hash = 0; }
 };
@@ -0,0 +1,545 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "board.hpp"
+#include "evaluation.hpp"
+#include "move.hpp"
+#include "piece.hpp"
+#include "transpositionTable.hpp"
+
+#define NEG_INF -1000000  // Close enough for all intents and purposes
+#define POS_INF 1000000
+
+#define MAX_PLY 128  // Deepest ply search and quiescence reach, history and killers are reserved for this many
+
+#define MATE_SCORE_BOUND (POS_INF - 1000)  // Scores past this are mates, NEG_INF + ply for the side getting mated
+
+#define LOSING_CAPTURE_PENALTY 1000  // Below any quiet move
+
+#define ASPIRATION_WINDOW 50     // Half width of the first window around the last iteration's score
+#define ASPIRATION_MIN_DEPTH 4  // Scores of shallower iterations jump around too much to aim at
+
+#define NULL_MOVE_MIN_DEPTH 3       // Below this the reduced search is mostly quiescence, not worth the pass
+#define REVERSE_FUTILITY_DEPTH 3    // Deepest node whose static eval is trusted to stay above beta
+#define REVERSE_FUTILITY_MARGIN 120  // Per ply of depth, what the side to move could lose before the search ends
+
+#define LMR_MIN_DEPTH 3    // Shallower searches have nothing to reduce
+#define LMR_MIN_MOVES 3    // Moves searched at full depth before the rest get reduced
+#define LMR_TABLE_SIZE 64  // Depths and move numbers past this reduce like the last entry
+#define LMP_MAX_DEPTH 3    // Deepest node where late quiet moves are skipped
+
+#define SKIP_PATTERN_SIZE 20  // Helpers past this many reuse the patterns from the start
+
+// Per helper, how many iterations it searches or skips in a row and where in that cycle it starts
+constexpr int SKIP_SIZE[SKIP_PATTERN_SIZE] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+constexpr int SKIP_PHASE[SKIP_PATTERN_SIZE] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+#define KILLER_SCORE 50  // Below the captures that don't lose material, above the quiet moves
+
+using namespace std;
+using namespace std::chrono_literals;
+
+struct MoveEval {
+    int eval;
+    Move bestMove;
+
+    MoveEval() : eval(NEG_INF), bestMove(Move(0, 0)) {}
+    MoveEval(int eval, Move bestMove) : eval(eval), bestMove(bestMove) {}
+};
+
+// Search features that can be switched off with setoption to measure what they save
+struct SearchOptions {
+    bool pvs = true;
+    bool aspirationWindows = true;
+    bool nullMove = true;
+    bool reverseFutility = true;
+    bool lateMoveReductions = true;
+    bool lateMovePruning = true;
+};
+
+// What one iteration of the main thread cost
+struct DepthStats {
+    int depth;
+    int eval;
+    int positionsSearched;
+    int64_t timeMs;
+    int nullWindowSearches;   // PVS scout searches of moves after the first
+    int reSearches;           // Scouts that failed high and were searched again with the full window
+    int aspirationReSearches;  // Root searches repeated after falling outside the aspiration window
+    int nullMoveCutoffs;
+    int reverseFutilityCutoffs;
+    int reducedSearches;       // Late moves searched shallower than the rest
+    int reducedReSearches;     // Reduced searches that beat alpha and were searched again at full depth
+    int lateMovesPruned;
+};
+
+/**
+ * @brief How many plies to take off a late move's search, growing with the log of both the depth left and the move's
+ * place in the ordered list. Filled once at startup.
+ */
+namespace LateMoveReductions {
+
+int TABLE[LMR_TABLE_SIZE][LMR_TABLE_SIZE];
+
+bool init() {
+    for (int depth = 1; depth < LMR_TABLE_SIZE; depth++) {
+        for (int moveNumber = 1; moveNumber < LMR_TABLE_SIZE; moveNumber++) {
+            TABLE[depth][moveNumber] = (int)(0.75 + log(depth) * log(moveNumber) / 2.25);
+        }
+    }
+
+    return true;
+}
+
+const bool INITIALIZED = init();
+
+inline int get(int depth, int moveNumber) {
+    return TABLE[min(depth, LMR_TABLE_SIZE - 1)][min(moveNumber, LMR_TABLE_SIZE - 1)];
+}
+
+}  // namespace LateMoveReductions
+
+// Quiet moves searched before the rest are skipped at shallow depths
+inline int lateMovePruningCount(int depth) { return 3 + depth * depth; }
+
+struct MoveScore {
+    int score;
+    Move move;
+
+    bool operator<(const MoveScore& other) const { return score < other.score; }
+    bool operator>(const MoveScore& other) const { return score > other.score; }
+};
+
+/**
+ * @brief One thread of a Lazy SMP search. Each worker has its own copy of the board and its own move ordering state
+ * and runs iterative deepening on its own, the only thing shared is the transposition table. Helpers start a depth
+ * later than their neighbours so the threads spread over different depths and fill the table for each other.
+ */
+class SearchWorker {
+   private:
+    Board m_board;
+    TranspositionTable& m_transpositionTable;
+    const SearchOptions m_options;
+    atomic<bool>& m_stop;  // Shared by every worker of the search
+    chrono::steady_clock::time_point m_searchEnd;
+    int m_id;
+    bool m_isMain;
+    bool m_searchCanceled = false;  // Stays set once time runs out so nothing half searched gets stored
+
+    MoveEval m_lastBestMove;
+    int m_depthReached = 0;
+
+    // Two quiet moves per ply that last caused a beta cutoff, likely to refute sibling positions as well
+    vector<array<Move, 2>> m_killers;
+
+    // Debug
+    int m_positionsSearched = 0;
+    DepthStats m_stats;  // Of the iteration being searched
+    vector<DepthStats> m_depthStats;
+
+   public:
+    SearchWorker(const Board& board, TranspositionTable& transpositionTable, const SearchOptions& options,
+                 atomic<bool>& stop, chrono::steady_clock::time_point searchEnd, int id)
+        : m_board(board),
+          m_transpositionTable(transpositionTable),
+          m_options(options),
+          m_stop(stop),
+          m_searchEnd(searchEnd),
+          m_id(id),
+          m_isMain(id == 0) {}
+
+    // Result of the deepest completed iteration, from the side to move's point of view
+    void iterativeDeepening(int searchDepth) {
+        // Every ply gains at least one depth, so the main search stays under MAX_PLY and quiescence stops there
+        searchDepth = min(searchDepth, MAX_PLY - 1);
+        m_board.reserveHistory(MAX_PLY);
+        m_killers.assign(MAX_PLY, {Move(), Move()});
+
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+
+        for (int i = 1; i <= searchDepth; i++) {
+            if (skipsDepth(i)) continue;
+
+            m_stats = DepthStats{i, 0, m_positionsSearched, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+            MoveEval searchResult = aspirationSearch(i);
+            if (isSearchCanceled()) break;
+
+            m_lastBestMove = searchResult;
+            m_depthReached = i;
+
+            m_stats.eval = searchResult.eval;
+            m_stats.positionsSearched = m_positionsSearched - m_stats.positionsSearched;
+            m_stats.timeMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - begin).count();
+            m_depthStats.push_back(m_stats);
+        }
+    }
+
+    // Searches the root in a narrow window around the last score, widening the side that fails until the score
+    // lands inside
+    MoveEval aspirationSearch(int depth) {
+        int alpha = NEG_INF;
+        int beta = POS_INF;
+        int delta = ASPIRATION_WINDOW;
+        int lastEval = m_lastBestMove.eval;
+
+        if (m_options.aspirationWindows && depth >= ASPIRATION_MIN_DEPTH && m_depthReached > 0 &&
+            abs(lastEval) < MATE_SCORE_BOUND) {
+            alpha = lastEval - delta;
+            beta = lastEval + delta;
+        }
+
+        while (true) {
+            MoveEval result = search(depth, 1, alpha, beta);
+            if (isSearchCanceled()) return result;
+
+            if (result.eval <= alpha && alpha > NEG_INF) {
+                alpha = max(alpha - delta, NEG_INF);
+            } else if (result.eval >= beta && beta < POS_INF) {
+                beta = min(beta + delta, POS_INF);
+            } else {
+                return result;
+            }
+
+            delta *= 2;
+            m_stats.aspirationReSearches++;
+        }
+    }
+
+    // Helpers skip iterations in runs of SKIP_SIZE starting at SKIP_PHASE, so at any time the threads are spread over
+    // several depths instead of all searching the same one with the same move ordering. The main thread skips none
+    inline bool skipsDepth(int depth) const {
+        if (m_isMain) return false;
+
+        int pattern = (m_id - 1) % SKIP_PATTERN_SIZE;
+        return (depth + SKIP_PHASE[pattern]) / SKIP_SIZE[pattern] % 2;
+    }
+
+    inline const MoveEval& getBestMove() const { return m_lastBestMove; }
+    inline int getDepthReached() const { return m_depthReached; }
+    inline int getPositionsSearched() const { return m_positionsSearched; }
+    inline const vector<DepthStats>& getDepthStats() const { return m_depthStats; }
+
+    // The main thread watches the clock and raises the shared stop flag, helpers only watch the flag
+    inline bool isSearchCanceled() {
+        if (m_searchCanceled) return true;
+
+        if (m_stop.load(memory_order_relaxed)) {
+            m_searchCanceled = true;
+        } else if (m_isMain && m_positionsSearched % 957 == 0 && chrono::steady_clock::now() > m_searchEnd - 3ms) {
+            m_searchCanceled = true;
+            m_stop.store(true, memory_order_relaxed);
+        }
+
+        return m_searchCanceled;
+    }
+
+    // Mate scores count plies from the root, the table stores them counted from the node so they hold wherever the
+    // position comes up again
+    static int scoreToTT(int score, int ply) {
+        if (score > MATE_SCORE_BOUND) return score + ply;
+        if (score < -MATE_SCORE_BOUND) return score - ply;
+        return score;
+    }
+
+    static int scoreFromTT(int score, int ply) {
+        if (score > MATE_SCORE_BOUND) return score - ply;
+        if (score < -MATE_SCORE_BOUND) return score + ply;
+        return score;
+    }
+
+    // Ply counts from 1 at the root, it can't be worked out from depth once searches are reduced
+    MoveEval search(int depth, int ply, int alpha = NEG_INF, int beta = POS_INF, bool allowNullMove = true) {
+        // Repeating a position is a draw, whoever it favours the other side can repeat it again
+        if (ply > 1 && m_board.isRepetition(1)) return MoveEval(0, Move(0, 0));
+
+        if (depth <= 0) {
+            return MoveEval(searchCaptures(alpha, beta, ply), Move(0, 0));
+        }
+
+        m_positionsSearched++;
+
+        if (isSearchCanceled()) {
+            return MoveEval(POS_INF, Move(0, 0));  // This move will never be picked
+        }
+
+        // An earlier search of this position cuts off if it went at least as deep, else its move is tried first
+        uint64_t key = m_board.getHash();
+        Move hashMove = ply == 1 ? m_lastBestMove.bestMove : Move();
+        TTEntry entry;
+
+        if (m_transpositionTable.probe(key, entry)) {
+            int score = scoreFromTT(entry.score, ply);
+            int bound = entry.getBound();
+
+            if (ply > 1 && entry.depth >= depth &&
+                (bound == Bound::EXACT || (bound == Bound::LOWER && score >= beta) ||
+                 (bound == Bound::UPPER && score <= alpha)))
+                return MoveEval(score, entry.move);
+
+            if (!entry.move.isNull()) hashMove = entry.move;
+        }
+
+        // Forward pruning, only in null window nodes where the exact score isn't needed
+        bool inCheck = m_board.isCheck();
+        bool prune = ply > 1 && !inCheck && beta - alpha == 1 && abs(beta) < MATE_SCORE_BOUND;
+
+        if (prune && (m_options.reverseFutility || m_options.nullMove)) {
+            int staticEval = evaluate();
+
+            // Reverse futility, this far above beta a few plies won't bring the score back down
+            if (m_options.reverseFutility && depth <= REVERSE_FUTILITY_DEPTH &&
+                staticEval - REVERSE_FUTILITY_MARGIN * depth >= beta) {
+                m_stats.reverseFutilityCutoffs++;
+                return MoveEval(staticEval, Move(0, 0));
+            }
+
+            // Null move, if passing still fails high a real move will too. Passing can be the best move when every
+            // move makes things worse, which happens in pawn endings, so those are skipped. Two passes in a row would
+            // just search the same position shallower
+            if (m_options.nullMove && allowNullMove && depth >= NULL_MOVE_MIN_DEPTH && staticEval >= beta &&
+                m_board.hasNonPawnMaterial(m_board.getTurn())) {
+                int reduction = depth > 6 ? 3 : 2;  // Adaptive R, reduce more where there's depth to spare
+
+                m_board.makeNullMove();
+                int eval = -search(depth - 1 - reduction, ply + 1, -beta, -beta + 1, false).eval;
+                m_board.unmakeNullMove();
+
+                if (isSearchCanceled()) return MoveEval(POS_INF, Move(0, 0));
+
+                // A mate found after passing isn't proven, so only claim beta
+                if (eval >= beta) {
+                    m_stats.nullMoveCutoffs++;
+                    return MoveEval(eval >= MATE_SCORE_BOUND ? beta : eval, Move(0, 0));
+                }
+            }
+        }
+
+        MoveList moves;
+        m_board.generateMoves<GenType::LEGAL>(moves);
+
+        if (moves.empty()) {
+            if (inCheck) return MoveEval(NEG_INF + ply, Move(0, 0));
+            return MoveEval(0, Move(0, 0));
+        }
+
+        if (ply > 1 && m_board.isFiftyMoveDraw()) return MoveEval(0, Move(0, 0));
+
+        orderMoves(moves, hashMove, false, ply);
+
+        bool pvNode = beta - alpha > 1;
+        int alphaOriginal = alpha;
+        MoveEval bestSoFar = MoveEval(NEG_INF, Move(0, 0));
+        for (size_t i = 0; i < moves.size(); i++) {
+            Move move = moves[i];
+
+            // Captures, promotions and killers are never late, whatever their place in the list
+            bool quiet = m_board.getPiece(move.getTo()) == Piece::NONE && !move.isEnPassant() && !move.isPromotion();
+            bool late = ply > 1 && !inCheck && quiet && i >= LMR_MIN_MOVES && !isKiller(move, ply);
+
+            m_board.makeMove(move);
+            m_transpositionTable.prefetch(m_board.getHash());  // In flight while the child checks for repetition
+
+            // Checks are never late either
+            if (late) late = !m_board.isCheck();
+
+            // Late move pruning, near the leaves the tail of the list is skipped once some move avoids getting mated
+            if (late && m_options.lateMovePruning && depth <= LMP_MAX_DEPTH && !pvNode &&
+                (int)i >= lateMovePruningCount(depth) && bestSoFar.eval > -MATE_SCORE_BOUND) {
+                m_board.unmakeLastMove();
+                m_stats.lateMovesPruned++;
+                continue;
+            }
+
+            // Late move reductions, a late move is searched shallower first and only gets the full depth if it beats
+            // alpha. The search still has to reach a real node, so at least one ply is left
+            int reduction = 0;
+            if (late && m_options.lateMoveReductions && depth >= LMR_MIN_DEPTH) {
+                reduction = LateMoveReductions::get(depth, i) - pvNode;
+                reduction = max(0, min(reduction, depth - 2));
+            }
+
+            // Principal variation search, after the first move the rest only have to be shown no better than alpha
+            // with a null window. One that fails high gets the full window to find its real score
+            MoveEval res;
+            if (i == 0) {
+                res = search(depth - 1, ply + 1, -beta, -alpha);
+            } else {
+                int scoutBeta = m_options.pvs ? alpha + 1 : beta;
+
+                res = search(depth - 1 - reduction, ply + 1, -scoutBeta, -alpha);
+                if (m_options.pvs) m_stats.nullWindowSearches++;
+
+                if (reduction > 0) {
+                    m_stats.reducedSearches++;
+
+                    if (-res.eval > alpha) {
+                        res = search(depth - 1, ply + 1, -scoutBeta, -alpha);
+                        m_stats.reducedReSearches++;
+                    }
+                }
+
+                if (m_options.pvs && -res.eval > alpha && -res.eval < beta) {
+                    res = search(depth - 1, ply + 1, -beta, -alpha);
+                    m_stats.reSearches++;
+                }
+            }
+            res.eval = -res.eval;  // Negamax flip
+            m_board.unmakeLastMove();
+
+            if (res.eval > bestSoFar.eval) {
+                bestSoFar.eval = res.eval;
+                bestSoFar.bestMove = move;
+            }
+            alpha = max(bestSoFar.eval, alpha);
+
+            if (beta <= alpha) {
+                if (quiet) storeKiller(move, ply);
+                break;
+            }
+        }
+
+        if (!m_searchCanceled) {
+            int bound = Bound::EXACT;
+            if (bestSoFar.eval >= beta) bound = Bound::LOWER;
+            if (bestSoFar.eval <= alphaOriginal) bound = Bound::UPPER;
+
+            // No move beat alpha, so none is known to be best
+            m_transpositionTable.store(key, depth, bound, scoreToTT(bestSoFar.eval, ply),
+                                       bound == Bound::UPPER ? Move() : bestSoFar.bestMove);
+        }
+
+        return bestSoFar;
+    }
+
+    inline bool isKiller(Move move, int ply) const { return move == m_killers[ply][0] || move == m_killers[ply][1]; }
+
+    inline void storeKiller(Move move, int ply) {
+        if (move == m_killers[ply][0]) return;
+
+        m_killers[ply][1] = m_killers[ply][0];
+        m_killers[ply][0] = move;
+    }
+
+    int searchCaptures(int alpha, int beta, int ply) {
+        m_positionsSearched++;
+
+        int eval = evaluate();
+        if (eval >= beta) {
+            return beta;
+        }
+        alpha = max(alpha, eval);
+        if (ply >= MAX_PLY) return alpha;  // No history reserved past here
+
+        // Only captures and promotions are generated, quiet moves would be skipped anyway
+        MoveList moves;
+        m_board.generateMoves<GenType::CAPTURES>(moves);
+
+        // Losing captures can't raise alpha when standing pat was already an option
+        orderMoves(moves, Move(), true);
+
+        for (Move move : moves) {
+            m_board.makeMove(move);
+            int eval = -searchCaptures(-beta, -alpha, ply + 1);
+            m_board.unmakeLastMove();
+
+            if (eval >= beta) return beta;
+            alpha = max(alpha, eval);
+        }
+
+        return alpha;
+    }
+
+    // Orders moves in place on the array with the hash move first, optionally dropping captures that lose material.
+    // Killers of the ply come right after the captures, ply 0 has none
+    void orderMoves(MoveList& moves, Move hashMove, bool dropLosingCaptures = false, int ply = 0) {
+        stackvector<int, MAX_MOVES> moveScores;
+        size_t kept = 0;
+
+        for (Move move : moves) {
+            if (move == hashMove) {
+                moveScores.push_back(POS_INF);  // Guarantee that best move gets searched first
+            } else if (ply > 0 && isKiller(move, ply) && m_board.getPiece(move.getTo()) == Piece::NONE) {
+                moveScores.push_back(KILLER_SCORE);
+            } else {
+                int score = staticMoveEval(move);
+
+                // Only losing captures score below every quiet move
+                if (dropLosingCaptures && score < -LOSING_CAPTURE_PENALTY && !move.isPromotion()) continue;
+                moveScores.push_back(score);
+            }
+
+            moves[kept++] = move;
+        }
+
+        moves.commit(moves.begin() + kept);
+
+        // Sort move array based on move scores (insertion sort)
+        for (size_t i = 1; i < moves.size(); i++) {
+            int scoreKey = moveScores[i];
+            Move moveKey = moves[i];
+
+            size_t j;
+            for (j = i; j > 0 && scoreKey > moveScores[j - 1]; j--) {
+                moveScores[j] = moveScores[j - 1];
+                moves[j] = moves[j - 1];
+            }
+            moveScores[j] = scoreKey;
+            moves[j] = moveKey;
+        }
+    }
+
+    int staticMoveEval(Move move) {
+        int score = 0;
+        int movedPiece = m_board.getPiece(move.getFrom());
+        int capturedPiece = m_board.getPiece(move.getTo());
+
+        // Promotion is probably good
+        if (move.isPromotion()) score += Piece::getMaterialValue(move.getPromotionPiece());
+
+        // Capture opponents high value pieces with our low value pieces, unless the exchange loses material. Losing
+        // captures go after the quiet moves
+        if (capturedPiece != Piece::NONE || move.isEnPassant()) {
+            // Taking something worth at least the capturer can't lose material, so skip the exchange
+            bool safe = Piece::getMaterialValue(capturedPiece) >= Piece::getMaterialValue(movedPiece);
+            int exchange = safe ? 0 : m_board.see(move);
+            if (exchange < 0) return score + exchange - LOSING_CAPTURE_PENALTY;
+
+            return score + 10 * Piece::getMaterialValue(capturedPiece) - Piece::getMaterialValue(movedPiece);
+        }
+
+        // Don't move piece to somewhere attacked by a pawn
+        if (m_board.isAttackedByPawn(move.getTo(), m_board.getNextTurn())) score -= Piece::getMaterialValue(movedPiece);
+
+        return score;
+    }
+
+    int evaluate() {
+        int eval = 0;
+
+        int numPieces = 0;
+
+        // Compute material from White's perspective
+        for (int piece : Piece::ALL_PIECES) {
+            int num = BitBoard::getNumToggled(m_board.getBitboard(piece));
+            eval += Piece::getMaterialValue(piece) * num * (Piece::isColor(piece, m_board.getTurn()) ? 1 : -1);
+            numPieces += num;
+        }
+
+        for (int piece : Piece::ALL_PIECES) {
+            for (int pos : m_board.getPieceLocations(piece)) {
+                eval += PieceValues::getPieceSquareValue(piece, pos, numPieces) *
+                        (Piece::isColor(piece, m_board.getTurn()) ? 1 : -1);
+            }
+        }
+
+        return eval;
+    }
+};
@@ -0,0 +1,79 @@
+// Search thread scaling benchmark
+// Build: g++ -O3 -o search_bench search_bench.cpp
+// Usage: search_bench [depth] [hash MB] [thread counts...]
+//
+// Searches a fixed set of positions to the given depth with each thread count, starting every search from an empty
+// hash table, and prints the time to depth and nodes per second next to the single thread run. Runs with more threads
+// than the machine has cores are marked, their speedup only shows overhead.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "engine.hpp"
+
+using namespace std;
+
+const vector<string> BENCH_FENS = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1B1PPP/R2QKB1R w KQ - 0 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "2r3k1/pp3ppp/4p3/3n4/3P4/1B3N2/PP3PPP/2R3K1 w - - 0 20",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+};
+
+int main(int argc, char* argv[]) {
+    int depth = argc > 1 ? stoi(argv[1]) : 7;
+    int hashMb = argc > 2 ? stoi(argv[2]) : 64;
+
+    vector<int> threadCounts;
+    for (int i = 3; i < argc; i++) threadCounts.push_back(stoi(argv[i]));
+    if (threadCounts.empty()) threadCounts = {1, 2, 4, 8, 16};
+
+    stringstream nullStream;
+    Engine engine(nullStream, nullStream);
+    engine.setHashSize(hashMb);
+
+    cout << "Depth " << depth << ", " << BENCH_FENS.size() << " positions, " << thread::hardware_concurrency()
+         << " hardware threads\n\n";
+    cout << "Threads    Time(ms)      Nodes        NPS  Speedup  NPS scaling\n";
+
+    int64_t baseUs = 0;
+    uint64_t baseNps = 0;
+
+    for (int threads : threadCounts) {
+        engine.setThreads(threads);
+
+        int64_t totalUs = 0;
+        uint64_t totalNodes = 0;
+
+        for (const string& fen : BENCH_FENS) {
+            engine.newGame(fen);
+            engine.clearHash();
+
+            chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+            engine.getBestMove(depth);
+            chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+            totalUs += chrono::duration_cast<chrono::microseconds>(end - begin).count();
+            totalNodes += engine.getPositionsSearched();
+        }
+
+        totalUs = max<int64_t>(totalUs, 1);
+        uint64_t nps = totalNodes * 1000000 / totalUs;
+        if (baseUs == 0) {
+            baseUs = totalUs;
+            baseNps = nps;
+        }
+
+        cout << setw(7) << threads << setw(12) << totalUs / 1000 << setw(11) << totalNodes << setw(11) << nps
+             << setw(9) << fixed << setprecision(2) << (double)baseUs / totalUs << setw(13) << (double)nps / baseNps
+             << ((unsigned)threads > thread::hardware_concurrency() ? "  more threads than cores" : "") << endl;
+    }
+
+    return 0;
+}
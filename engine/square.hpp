@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <string>
 
@@ -76,8 +78,8 @@ constexpr int H8 = 63;
 
 /// Large constants at bottom of file
 
-inline int rank(int square) { return square / 8; }
-inline int file(int square) { return square % 8; }
+constexpr int rank(int square) { return square / 8; }
+constexpr int file(int square) { return square % 8; }
 
 bool isOnBoard(int square) { return square >= 0 && square < 64; }
 
@@ -126,27 +128,23 @@ constexpr int ALL_SQUARES[64] = {0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11,
                                  44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63};
 
 constexpr int DIRECTIONS[8] = {-8, 8, -1, 1, -9, -7, 7, 9};
-constexpr int MAX_SLIDING_DISTANCE[64][8] = {
-    {0, 7, 0, 7, 0, 0, 0, 7}, {0, 7, 1, 6, 0, 0, 1, 6}, {0, 7, 2, 5, 0, 0, 2, 5},
-    {0, 7, 3, 4, 0, 0, 3, 4}, {0, 7, 4, 3, 0, 0, 4, 3}, {0, 7, 5, 2, 0, 0, 5, 2},
-    {0, 7, 6, 1, 0, 0, 6, 1}, {0, 7, 7, 0, 0, 0, 7, 0}, {1, 6, 0, 7, 0, 1, 0, 6},
-    {1, 6, 1, 6, 1, 1, 1, 6}, {1, 6, 2, 5, 1, 1, 2, 5}, {1, 6, 3, 4, 1, 1, 3, 4},
-    {1, 6, 4, 3, 1, 1, 4, 3}, {1, 6, 5, 2, 1, 1, 5, 2}, {1, 6, 6, 1, 1, 1, 6, 1},
-    {1, 6, 7, 0, 1, 0, 6, 0}, {2, 5, 0, 7, 0, 2, 0, 5}, {2, 5, 1, 6, 1, 2, 1, 5},
-    {2, 5, 2, 5, 2, 2, 2, 5}, {2, 5, 3, 4, 2, 2, 3, 4}, {2, 5, 4, 3, 2, 2, 4, 3},
-    {2, 5, 5, 2, 2, 2, 5, 2}, {2, 5, 6, 1, 2, 1, 5, 1}, {2, 5, 7, 0, 2, 0, 5, 0},
-    {3, 4, 0, 7, 0, 3, 0, 4}, {3, 4, 1, 6, 1, 3, 1, 4}, {3, 4, 2, 5, 2, 3, 2, 4},
-    {3, 4, 3, 4, 3, 3, 3, 4}, {3, 4, 4, 3, 3, 3, 4, 3}, {3, 4, 5, 2, 3, 2, 4, 2},
-    {3, 4, 6, 1, 3, 1, 4, 1}, {3, 4, 7, 0, 3, 0, 4, 0}, {4, 3, 0, 7, 0, 4, 0, 3},
-    {4, 3, 1, 6, 1, 4, 1, 3}, {4, 3, 2, 5, 2, 4, 2, 3}, {4, 3, 3, 4, 3, 4, 3, 3},
-    {4, 3, 4, 3, 4, 3, 3, 3}, {4, 3, 5, 2, 4, 2, 3, 2}, {4, 3, 6, 1, 4, 1, 3, 1},
-    {4, 3, 7, 0, 4, 0, 3, 0}, {5, 2, 0, 7, 0, 5, 0, 2}, {5, 2, 1, 6, 1, 5, 1, 2},
-    {5, 2, 2, 5, 2, 5, 2, 2}, {5, 2, 3, 4, 3, 4, 2, 2}, {5, 2, 4, 3, 4, 3, 2, 2},
-    {5, 2, 5, 2, 5, 2, 2, 2}, {5, 2, 6, 1, 5, 1, 2, 1}, {5, 2, 7, 0, 5, 0, 2, 0},
-    {6, 1, 0, 7, 0, 6, 0, 1}, {6, 1, 1, 6, 1, 6, 1, 1}, {6, 1, 2, 5, 2, 5, 1, 1},
-    {6, 1, 3, 4, 3, 4, 1, 1}, {6, 1, 4, 3, 4, 3, 1, 1}, {6, 1, 5, 2, 5, 2, 1, 1},
-    {6, 1, 6, 1, 6, 1, 1, 1}, {6, 1, 7, 0, 6, 0, 1, 0}, {7, 0, 0, 7, 0, 7, 0, 0},
-    {7, 0, 1, 6, 1, 6, 0, 0}, {7, 0, 2, 5, 2, 5, 0, 0}, {7, 0, 3, 4, 3, 4, 0, 0},
-    {7, 0, 4, 3, 4, 3, 0, 0}, {7, 0, 5, 2, 5, 2, 0, 0}, {7, 0, 6, 1, 6, 1, 0, 0},
-    {7, 0, 7, 0, 7, 0, 0, 0}};  // Maximum sliding distance for each square and direction
+
+// Squares a slider can travel from each square in each of DIRECTIONS before leaving the board
+constexpr array<array<int, 8>, NUM_SQUARES> slidingDistances() {
+    array<array<int, 8>, NUM_SQUARES> distances = {};
+
+    for (int square = 0; square < NUM_SQUARES; square++) {
+        int up = 7 - rank(square);
+        int down = rank(square);
+        int left = file(square);
+        int right = 7 - file(square);
+
+        distances[square] = {down, up, left, right, min(down, left), min(down, right), min(up, left), min(up, right)};
+    }
+
+    return distances;
+}
+
+constexpr array<array<int, 8>, NUM_SQUARES> MAX_SLIDING_DISTANCE = slidingDistances();
+
 }  // namespace Square
\ No newline at end of file
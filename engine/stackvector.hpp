@@ -1,86 +1,114 @@
 #pragma once
 
-#include <array>
-#include <stdexcept>
+#include <cassert>
+#include <cstring>
+#include <new>
+#include <type_traits>
 
 using namespace std;
 
 /**
  * @brief Fast array with some vector functions on stack, Implements only fast operations
  *
+ * Storage is left uninitialized and only the used part is copied. Bounds are checked with assertions, so a release
+ * build (NDEBUG) does no checking at all.
  *
- * @tparam T
+ * @tparam T Must be trivially copyable
  * @tparam N
  */
 template <typename T, size_t _MaxCapacity>
 class stackvector {
+    static_assert(is_trivially_copyable<T>::value, "stackvector copies its items with memcpy");
+
    private:
     size_t m_size = 0;
-    array<T, _MaxCapacity> m_arr;
+    alignas(T) unsigned char m_storage[_MaxCapacity * sizeof(T)];
+
+    inline T* data() { return reinterpret_cast<T*>(m_storage); }
+    inline const T* data() const { return reinterpret_cast<const T*>(m_storage); }
 
    public:
-    using iterator = typename array<T, _MaxCapacity>::iterator;
-    using const_iterator = typename array<T, _MaxCapacity>::const_iterator;
+    using iterator = T*;
+    using const_iterator = const T*;
 
     stackvector() : m_size(0) {}
-    stackvector(const stackvector& other) {
+    stackvector(const stackvector& other) : m_size(other.m_size) { memcpy(m_storage, other.m_storage, m_size * sizeof(T)); }
+
+    stackvector& operator=(const stackvector& other) {
         m_size = other.m_size;
-        m_arr = other.m_arr;
-    };
-    stackvector(stackvector&& other) noexcept = default;
+        memcpy(m_storage, other.m_storage, m_size * sizeof(T));
+        return *this;
+    }
 
     // Adds an item to the end of the array
-    void push_back(T item) {
-        if (m_size == _MaxCapacity) throw range_error("Max array size exceeded");
+    inline void push_back(T item) {
+        assert(m_size < _MaxCapacity && "Max array size exceeded");
+
+        data()[m_size++] = item;
+    }
+
+    // Constructs an item in place at the end of the array
+    template <typename... Args>
+    inline T& emplace_back(Args&&... args) {
+        assert(m_size < _MaxCapacity && "Max array size exceeded");
 
-        m_arr[m_size] = item;
-        m_size++;
+        return *new (&data()[m_size++]) T(static_cast<Args&&>(args)...);
     }
 
     // Removes the last item from the array
-    T pop_back() {
-        if (m_size == 0) throw range_error("Empty Array cannot be popped");
+    inline T pop_back() {
+        assert(m_size > 0 && "Empty Array cannot be popped");
 
-        m_size--;
-        return m_arr[m_size];
+        return data()[--m_size];
+    }
+
+    inline void append(const T* items, size_t count) {
+        assert(m_size + count <= _MaxCapacity && "Max array size exceeded");
+
+        memcpy(data() + m_size, items, count * sizeof(T));
+        m_size += count;
     }
 
     template <size_t _OtherSize>
-    void append(const stackvector<T, _OtherSize>& other) {
-        if (other.size() + size() > _MaxCapacity) throw range_error("Max array size exceeded");
+    inline void append(const stackvector<T, _OtherSize>& other) {
+        append(other.begin(), other.size());
+    }
+
+    // Writable tail, write up to capacity() - size() items from tail() then commit how many were written:
+    //     Move* out = moves.tail();
+    //     *out++ = move;
+    //     moves.commit(out);
+    inline T* tail() { return data() + m_size; }
 
-        for (T i : other) {
-            m_arr[m_size] = i;
-            m_size++;
-        }
+    inline void commit(const T* newEnd) {
+        m_size = newEnd - data();
+        assert(m_size <= _MaxCapacity && "Max array size exceeded");
     }
 
+    inline void clear() { m_size = 0; }
+
     inline size_t size() const { return m_size; }
     inline bool empty() const { return m_size == 0; }
     constexpr size_t capacity() const { return _MaxCapacity; }
 
     // Provides access to elements by index
-    T& operator[](std::size_t index) {
-        if (index >= m_size) {
-            throw std::out_of_range("Index out of range");
-        }
-        return m_arr[index];
+    inline T& operator[](size_t index) {
+        assert(index < m_size && "Index out of range");
+        return data()[index];
     }
 
-    const T& operator[](std::size_t index) const {
-        if (index >= m_size) {
-            throw std::out_of_range("Index out of range");
-        }
-        return m_arr[index];
+    inline const T& operator[](size_t index) const {
+        assert(index < m_size && "Index out of range");
+        return data()[index];
     }
 
     // Iterators
-    iterator begin() { return m_arr.begin(); }
-    iterator end() { return m_arr.begin() + m_size; }
+    iterator begin() { return data(); }
+    iterator end() { return data() + m_size; }
 
-    const_iterator begin() const { return m_arr.begin(); }
-    const_iterator end() const { return m_arr.begin() + m_size; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + m_size; }
 
-    const_iterator cbegin() const { return m_arr.cbegin(); }
-    const_iterator cend() const { return m_arr.cbegin() + m_size; }
+    const_iterator cbegin() const { return data(); }
+    const_iterator cend() const { return data() + m_size; }
 };
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+
+#include "largePages.hpp"
+#include "move.hpp"
+
+using namespace std;
+
+#define TT_BUCKET_SIZE 4  // Entries sharing one index, 4 * 16 bytes fills a cache line
+
+// What a stored score says about the real score
+namespace Bound {
+constexpr int NONE = 0;
+constexpr int UPPER = 1;  // Failed low, the score is at most this
+constexpr int LOWER = 2;  // Failed high, the score is at least this
+constexpr int EXACT = 3;
+}  // namespace Bound
+
+struct TTEntry {
+    uint64_t key;
+    int32_t score;  // Mate scores are stored relative to this node, see SearchWorker::scoreToTT
+    Move move;
+    int8_t depth;
+    uint8_t generationBound;  // Generation in the top 6 bits, bound in the bottom 2
+
+    inline int getBound() const { return generationBound & 0b11; }
+    inline int getGeneration() const { return generationBound >> 2; }
+
+    // Everything but the key in one word: score, move, depth, generation and bound from the low bits up
+    uint64_t pack() const {
+        return (uint64_t)(uint32_t)score | (uint64_t)move.getData() << 32 | (uint64_t)(uint8_t)depth << 48 |
+               (uint64_t)generationBound << 56;
+    }
+
+    static TTEntry unpack(uint64_t key, uint64_t data) {
+        return TTEntry{key, (int32_t)(uint32_t)data, Move::fromData(data >> 32), (int8_t)(data >> 48),
+                       (uint8_t)(data >> 56)};
+    }
+};
+
+/**
+ * @brief Search results keyed by Zobrist key, in buckets of TT_BUCKET_SIZE entries. A new result replaces the entry
+ * for the same key, else the shallowest entry, counting entries from older searches as shallower the older they are.
+ * Buckets are cache line aligned and live in a LargePageBuffer, so a probe touches one line and rarely misses the TLB.
+ *
+ * Every search thread reads and writes the table without locks. A slot keeps its key XORed with its data, so a slot
+ * torn by two threads writing at once no longer matches its key and reads as a miss.
+ */
+class TranspositionTable {
+   private:
+    struct Slot {
+        uint64_t keyXorData;
+        uint64_t data;
+    };
+
+    struct alignas(64) Bucket {
+        Slot slots[TT_BUCKET_SIZE];
+    };
+
+    static_assert(sizeof(Bucket) == 64, "A bucket should fill one cache line");
+
+    LargePageBuffer m_memory;
+    Bucket* m_buckets = nullptr;
+    size_t m_numBuckets = 0;
+    uint64_t m_mask = 0;
+    uint8_t m_generation = 0;
+
+    inline Bucket& getBucket(uint64_t key) { return m_buckets[key & m_mask]; }
+
+    // Relaxed atomics compile to plain moves, the XOR check is what catches torn slots
+    static inline TTEntry load(const Slot& slot) {
+        uint64_t data = __atomic_load_n(&slot.data, __ATOMIC_RELAXED);
+        return TTEntry::unpack(__atomic_load_n(&slot.keyXorData, __ATOMIC_RELAXED) ^ data, data);
+    }
+
+    static inline void save(Slot& slot, const TTEntry& entry) {
+        uint64_t data = entry.pack();
+        __atomic_store_n(&slot.keyXorData, entry.key ^ data, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot.data, data, __ATOMIC_RELAXED);
+    }
+
+    // Generations since the entry was written, wrapping at 64
+    inline int getAge(const TTEntry& entry) const { return (m_generation - entry.getGeneration()) & 0b111111; }
+
+   public:
+    // Size is rounded down to a power of two number of buckets, at least one. Throws bad_alloc and keeps the old table
+    // if the new one can't be allocated
+    void resize(size_t sizeMb) {
+        size_t numBuckets = sizeMb * 1024 * 1024 / sizeof(Bucket);
+
+        size_t powerOfTwo = 1;
+        while (powerOfTwo * 2 <= numBuckets) powerOfTwo *= 2;
+
+        m_memory.allocate(powerOfTwo * sizeof(Bucket));
+        m_buckets = static_cast<Bucket*>(m_memory.data());
+        m_numBuckets = powerOfTwo;
+        m_mask = powerOfTwo - 1;
+        m_generation = 0;
+    }
+
+    // Empty entries are all zero bytes
+    void clear() {
+        m_memory.clear();
+        m_generation = 0;
+    }
+
+    // Start loading the bucket for a position that is about to be probed
+    inline void prefetch(uint64_t key) { __builtin_prefetch(&getBucket(key)); }
+
+    // Per mille of entries written by the current search, estimated from the first buckets like UCI's hashfull
+    int hashfull() const {
+        size_t sampled = min<size_t>(m_numBuckets, 1000);
+        int used = 0;
+
+        for (size_t i = 0; i < sampled; i++) {
+            for (const Slot& slot : m_buckets[i].slots) {
+                TTEntry entry = load(slot);
+                used += entry.getBound() != Bound::NONE && entry.getGeneration() == m_generation;
+            }
+        }
+
+        return used * 1000 / (sampled * TT_BUCKET_SIZE);
+    }
+
+    inline bool usesHugeTlb() const { return m_memory.isHugeTlb(); }
+
+    // Call once per search so older entries can be told apart
+    void newSearch() { m_generation = (m_generation + 1) & 0b111111; }
+
+    bool probe(uint64_t key, TTEntry& result) {
+        for (const Slot& slot : getBucket(key).slots) {
+            TTEntry entry = load(slot);
+
+            if (entry.key == key && entry.getBound() != Bound::NONE) {
+                result = entry;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void store(uint64_t key, int depth, int bound, int score, Move move) {
+        Slot* replace = nullptr;
+        TTEntry replaced;
+
+        for (Slot& slot : getBucket(key).slots) {
+            TTEntry entry = load(slot);
+
+            if (entry.key == key) {
+                replace = &slot;
+                if (move.isNull()) move = entry.move;  // Keep the old best move over none
+                break;
+            }
+
+            if (!replace || entry.depth - 4 * getAge(entry) < replaced.depth - 4 * getAge(replaced)) {
+                replace = &slot;
+                replaced = entry;
+            }
+        }
+
+        save(*replace, TTEntry{key, score, move, (int8_t)depth, (uint8_t)(m_generation << 2 | bound)});
+    }
+};
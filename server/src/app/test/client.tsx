@@ -14,7 +14,10 @@ import { boardFromFen, STARTING_FEN } from "@/utils/chess/BoardFromFen";
 import EvalBar from "../_chess/EvalBar";
 import { MoveObj } from "@/engine/engineFunctions/moves/getValidMoves";
 import { Piece } from "@/utils/chess/GetPiece";
-import { squareToUci } from "@/engine/engineFunctions/moves/moveHelper";
+import {
+  moveToUci,
+  squareToUci,
+} from "@/engine/engineFunctions/moves/moveHelper";
 import {
   solveBlackTestEngineBestMove,
   solveWhiteTestEngineBestMove,
@@ -108,26 +111,10 @@ export default function Client() {
     setMoveHistory(newMoveHistory);
 
     if (playGame !== null && playGame < testGameFens.length) {
-      // Check for draw by repetition
-      const lastPosition = newMoveHistory[newMoveHistory.length - 1].fen;
-      // Check if the last position has been seen 3 times before (can ignore the last two numbers in the FEN)
-      const lastPositionWithoutTurn = lastPosition
-        .split(" ")
-        .slice(0, 4)
-        .join(" ");
-
-      const lastPositionCount = newMoveHistory.filter(
-        (move) =>
-          move.fen.split(" ").slice(0, 4).join(" ") === lastPositionWithoutTurn
-      ).length;
-
-      if (lastPositionCount >= 3) {
-        setPlayGame(playGame + 1);
-        setDraws((prev) => prev + 1);
-        return;
-      }
+      // The engine checks repetitions and the fifty move rule from the move list
+      const uciMoves = newMoveHistory.map((step) => moveToUci(step.move));
 
-      getGameWinner(lastPosition).then((winner) => {
+      getGameWinner(testGameFens[playGame], uciMoves).then((winner) => {
         if (winner === "draw") {
           setPlayGame(playGame + 1);
           setDraws((prev) => prev + 1);
@@ -345,9 +332,14 @@ export default function Client() {
 
           <div className="flex justify-between">
             <h3 className="font-bold mb-1">Moves</h3>
+            {/* The engine judges a test game from its whole move list, so it can't be cleared mid game */}
             <h3
-              className="mb-1 cursor-pointer hover:underline "
-              onClick={() => setMoveHistory([])}
+              className={`mb-1 ${
+                playGame === null
+                  ? "cursor-pointer hover:underline"
+                  : "text-neutral-500 cursor-not-allowed"
+              }`}
+              onClick={() => playGame === null && setMoveHistory([])}
             >
               Clear
             </h3>
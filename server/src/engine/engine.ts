@@ -137,9 +137,10 @@ export class Engine {
   }
 
   // Example method using sendCommand
-  async position(fen: string) {
+  async position(fen: string, moves: string[] = []) {
     try {
-      const output = await this.sendCommand(`position fen ${fen}`);
+      const movesArg = moves.length > 0 ? ` moves ${moves.join(" ")}` : "";
+      const output = await this.sendCommand(`position fen ${fen}${movesArg}`);
       console.log("Position output", output);
     } catch (error) {
       console.error("Error setting position:", error);
@@ -1,10 +1,10 @@
 "use server";
 
 import { engine } from "@/engine";
-import { position } from "../engineOperations";
 
-export async function getGameWinner(fen: string) {
-  await position(fen);
+// The engine needs the moves from the start of the game to see repetitions
+export async function getGameWinner(startFen: string, uciMoves: string[]) {
+  await engine.position(startFen, uciMoves);
 
   return await engine.getGameWinner();
 }
@@ -1,3 +1,18 @@
+import type { MoveObj } from "./getValidMoves";
+
 export function squareToUci(square: number) {
   return String.fromCharCode(97 + (square % 8)) + (Math.floor(square / 8) + 1);
 }
+
+const PROMOTION_CHARS = ["", "", "n", "b", "r", "q"];
+
+export function moveToUci(move: MoveObj) {
+  const promotion =
+    move.promotion !== null ? PROMOTION_CHARS[move.promotion & 7] : "";
+
+  return (
+    squareToUci(move.from.y * 8 + move.from.x) +
+    squareToUci(move.to.y * 8 + move.to.x) +
+    promotion
+  );
+}